@@ -0,0 +1,85 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright (c) 2023 Rainer Holzner <rholzner@web.de> */
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdatomic.h>
+#include <errno.h>
+#include "alloc.h"
+
+#ifdef __GLIBC__
+
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t num, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+extern void *__libc_memalign(size_t alignment, size_t size);
+
+/* Relaxed: the count is only read once the threads are done */
+static atomic_long calls;
+
+/* These replace the functions of the C library for the whole program,
+ * free() stays as it is.
+ */
+void *malloc(size_t size)
+{
+	atomic_fetch_add_explicit(&calls, 1, memory_order_relaxed);
+	return __libc_malloc(size);
+}
+
+void *calloc(size_t num, size_t size)
+{
+	atomic_fetch_add_explicit(&calls, 1, memory_order_relaxed);
+	return __libc_calloc(num, size);
+}
+
+void *realloc(void *ptr, size_t size)
+{
+	atomic_fetch_add_explicit(&calls, 1, memory_order_relaxed);
+	return __libc_realloc(ptr, size);
+}
+
+void *memalign(size_t alignment, size_t size)
+{
+	atomic_fetch_add_explicit(&calls, 1, memory_order_relaxed);
+	return __libc_memalign(alignment, size);
+}
+
+void *aligned_alloc(size_t alignment, size_t size)
+{
+	atomic_fetch_add_explicit(&calls, 1, memory_order_relaxed);
+	return __libc_memalign(alignment, size);
+}
+
+int posix_memalign(void **ptr, size_t alignment, size_t size)
+{
+	void *p;
+
+	atomic_fetch_add_explicit(&calls, 1, memory_order_relaxed);
+	/* A power of two multiple of sizeof(void *) */
+	if (alignment % sizeof(void *) != 0 ||
+			(alignment & (alignment - 1)) != 0 || alignment == 0)
+	{
+		return EINVAL;
+	}
+	p = __libc_memalign(alignment, size);
+	if (!p && size)
+	{
+		return ENOMEM;
+	}
+	*ptr = p;
+	return 0;
+}
+
+long alloc_count(void)
+{
+	return atomic_load_explicit(&calls, memory_order_relaxed);
+}
+
+#else
+
+long alloc_count(void)
+{
+	return -1;
+}
+
+#endif
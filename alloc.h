@@ -0,0 +1,17 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright (c) 2023 Rainer Holzner <rholzner@web.de> */
+
+#ifndef _ALLOC_H_
+#define _ALLOC_H_
+
+/* Counts the calls of malloc(), calloc(), realloc(), memalign(),
+ * aligned_alloc() and posix_memalign() of the whole process, including those of the C library itself, so that a run can
+ * show that it does not allocate once it is warmed up.
+ * Only with the GNU C library, whose functions can be replaced and
+ * still be called under another name.
+ */
+
+/* Returns the number of calls so far, or -1 if they are not counted */
+long alloc_count(void);
+
+#endif
@@ -0,0 +1,1037 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright (c) 2023 Rainer Holzner <rholzner@web.de> */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <signal.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include "batch.h"
+#include "grid.h"
+#include "search.h"
+#include "hist.h"
+#include "checkpoint.h"
+#include "perf.h"
+#include "hashdb.h"
+#include "engine.h"
+#include "minimal.h"
+#include "alloc.h"
+#include "record.h"
+#include "progress.h"
+
+/* Number of lines read before the workers start on them */
+#define BATCH_CHUNK 4096
+#define OUTPUT_BUFFER_SIZE (1 << 16)
+#define INPUT_BUFFER_SIZE (1 << 16)
+/* Longer lines cannot be puzzles, their rest is skipped */
+#define INPUT_LINE_MAX 256
+/* Workers do not share cache lines */
+#define WORKER_ALIGN 64
+
+static const char *status_names[ST_NUM] =
+{
+	"solved", "complete", "partial", "invalid", "unsolvable", "error",
+	"reduced", "minimal", "redundant", "ambiguous", "budget"
+};
+
+typedef struct _job
+{
+	Grid puzzle;
+	/* Or the reduced puzzle */
+	Grid solution;
+	/* The solution was found, also if the puzzle has more than one */
+	bool found;
+	Status status;
+	/* Number of solutions, -1 if they were not counted */
+	int count;
+	/* Nodes of the engine that counted them, -1 if not counted */
+	long long nodes;
+	size_t iterations;
+	uint64_t ns;
+	/* Record index, counting input lines from 0 across all files */
+	size_t index;
+} Job;
+
+/* All working memory of a thread, allocated before the first puzzle and
+ * reset by search_init() and engine_init() for each puzzle
+ */
+typedef struct _worker
+{
+	_Alignas(WORKER_ALIGN) pthread_t thread;
+	Search search;
+	Engine engine;
+	Hist hist;
+	Slowest slowest;
+	/* Puzzles found in the store */
+	size_t store_hits;
+	/* Published for the progress report. Only the worker writes them,
+	 * so a relaxed load and store is enough to add.
+	 */
+	atomic_size_t done;
+	atomic_ullong iterations;
+	/* Record index and start time of the current puzzle, 0 if idle */
+	atomic_size_t busy_index;
+	atomic_ullong busy_since;
+} Worker;
+
+/* Reads lines from a list of files one after another. After the first
+ * file, nothing is allocated: the FILE is reopened for the next file, and
+ * the buffers have a fixed size.
+ */
+typedef struct _input
+{
+	char **files;
+	int num_files, cur;
+	/* The current file, or NULL between two files */
+	FILE *fp;
+	/* The FILE of the files, kept open for the next one */
+	FILE *file;
+	char line[INPUT_LINE_MAX];
+	int error;
+	/* Size of the current file and of the files before, 0 if unknown */
+	off_t size, before;
+} Input;
+
+static const Batch_Options *options;
+static Job jobs[BATCH_CHUNK];
+static size_t num_jobs;
+static atomic_size_t next_job;
+static pthread_barrier_t barrier_start, barrier_done;
+static bool quit;
+static Worker *workers;
+static size_t num_workers;
+static FILE *out;
+/* Set by SIGINT and SIGTERM while a checkpoint file is in use */
+static volatile sig_atomic_t interrupted;
+/* Only one instance, it is too large for the stack */
+static Checkpoint checkpoint;
+static Perf perf;
+/* Known solutions, used if store is true */
+static Hashdb db;
+static bool store;
+static Progress progress;
+/* Start of this run, and the records read and resumed since */
+static uint64_t run_start;
+static atomic_size_t records_read;
+static size_t records_resumed;
+/* Bytes of all input files, -1 if unknown, and the bytes read */
+static off_t input_total;
+static atomic_llong input_pos;
+
+static uint64_t now_ns(void)
+{
+	struct timespec tp;
+
+	clock_gettime(CLOCK_MONOTONIC, &tp);
+	return (uint64_t)tp.tv_sec * 1000000000u + (uint64_t)tp.tv_nsec;
+}
+
+/* Returns the size of file number k, or -1 if it is not a regular file */
+static off_t input_file_size(const Input *in, int k)
+{
+	struct stat st;
+	int ret;
+
+	ret = (in->num_files == 0) ? fstat(STDIN_FILENO, &st) :
+		stat(in->files[k], &st);
+	return (ret == 0 && S_ISREG(st.st_mode)) ? st.st_size : -1;
+}
+
+/* Returns the size of all files, or -1 if unknown */
+static off_t input_size(const Input *in)
+{
+	off_t size, total = 0;
+	int k;
+
+	for (k = 0; k < in->num_files || (k == 0 && in->num_files == 0); k++)
+	{
+		if ((size = input_file_size(in, k)) < 0)
+		{
+			return -1;
+		}
+		total += size;
+	}
+	return total;
+}
+
+/* Opens the current file.
+ * Returns 0 on success, 1 if there are no more files, else -1.
+ */
+static int input_open(Input *in)
+{
+	static char input_buffer[INPUT_BUFFER_SIZE];
+
+	if (in->num_files == 0 && in->cur == 0)
+	{
+		in->fp = stdin;
+	}
+	else if (in->cur < in->num_files)
+	{
+		in->file = in->file ? freopen(in->files[in->cur], "r", in->file) :
+			fopen(in->files[in->cur], "r");
+		if (!in->file)
+		{
+			perror(in->files[in->cur]);
+			in->error = 1;
+			return -1;
+		}
+		in->fp = in->file;
+	}
+	else
+	{
+		return 1;
+	}
+	setvbuf(in->fp, input_buffer, _IOFBF, sizeof(input_buffer));
+	in->size = input_file_size(in, in->cur);
+	if (in->size < 0)
+	{
+		in->size = 0;
+	}
+	return 0;
+}
+
+/* Continues reading at byte offset of file number file.
+ * Returns 0 on success, else -1.
+ */
+static int input_seek(Input *in, size_t file, off_t offset)
+{
+	off_t size;
+	int ret, k;
+
+	in->before = 0;
+	for (k = 0; k < (int)file; k++)
+	{
+		if ((size = input_file_size(in, k)) > 0)
+		{
+			in->before += size;
+		}
+	}
+	in->cur = (int)file;
+	ret = input_open(in);
+	if (ret == 0 && offset && fseeko(in->fp, offset, SEEK_SET) == -1)
+	{
+		perror("fseeko");
+		in->error = 1;
+		ret = -1;
+	}
+	return (ret < 0) ? -1 : 0;
+}
+
+/* Position of the next line that input_read_line() returns */
+static void input_tell(const Input *in, size_t *file, off_t *offset)
+{
+	*file = (size_t)in->cur;
+	*offset = in->fp ? ftello(in->fp) : 0;
+}
+
+/* Returns the length of the next line, or -1 after the last line of the
+ * last file.
+ */
+static ssize_t input_read_line(Input *in)
+{
+	size_t len;
+	int c;
+
+	for (;;)
+	{
+		if (!in->fp && input_open(in) != 0)
+		{
+			return -1;
+		}
+		if (fgets(in->line, sizeof(in->line), in->fp))
+		{
+			len = strlen(in->line);
+			if (len == sizeof(in->line) - 1 && in->line[len-1] != '\n')
+			{
+				/* Too long, the length tells the caller */
+				while ((c = getc(in->fp)) != EOF && c != '\n')
+				{
+				}
+			}
+			return (ssize_t)len;
+		}
+		if (ferror(in->fp))
+		{
+			perror("fgets");
+			in->error = 1;
+		}
+		in->fp = NULL;
+		in->cur++;
+		in->before += in->size;
+		if (in->error)
+		{
+			return -1;
+		}
+	}
+}
+
+static void run_job(Worker *w, Job *job)
+{
+	Hashdb_Result r;
+	uint64_t t0;
+	int ret;
+
+	if (job->status == ST_ERROR)
+	{
+		return;
+	}
+	t0 = now_ns();
+	atomic_store_explicit(&w->busy_index, job->index, memory_order_relaxed);
+	atomic_store_explicit(&w->busy_since, t0, memory_order_relaxed);
+	ret = grid_check(job->puzzle);
+	if (ret < 0)
+	{
+		job->status = ST_INVALID;
+	}
+	else if (options->mode == BM_CHECK)
+	{
+		job->status = (ret == 0) ? ST_COMPLETE : ST_PARTIAL;
+	}
+	else if (options->mode == BM_REDUCE)
+	{
+		memcpy(job->solution, job->puzzle, sizeof(job->solution));
+		ret = minimal_reduce(&w->engine, job->solution);
+		job->status = (ret == -1) ? ST_UNSOLVABLE :
+			(ret == -2) ? ST_AMBIGUOUS : ST_REDUCED;
+	}
+	else if (options->mode == BM_MINIMAL)
+	{
+		ret = minimal_check(&w->engine, job->puzzle);
+		job->status = (ret == -1) ? ST_UNSOLVABLE :
+			(ret == -2) ? ST_AMBIGUOUS :
+			(ret == 0) ? ST_MINIMAL : ST_REDUNDANT;
+	}
+	else if (store &&
+			(r = hashdb_get(&db, job->puzzle, job->solution)) != HR_NONE)
+	{
+		job->found = (r == HR_SOLVED);
+		job->status = job->found ? ST_SOLVED : ST_UNSOLVABLE;
+		w->store_hits++;
+	}
+	else
+	{
+		search_init(&w->search, job->puzzle);
+		ret = search_run(&w->search,
+				options->budget ? options->budget : SIZE_MAX, NULL);
+		job->iterations = w->search.iterations;
+		job->found = (ret == 0);
+		if (job->found)
+		{
+			search_get(&w->search, job->solution);
+			job->status = ST_SOLVED;
+		}
+		else
+		{
+			job->status = (ret > 0) ? ST_BUDGET : ST_UNSOLVABLE;
+		}
+	}
+	if (options->count && options->mode == BM_SOLVE &&
+			job->status != ST_INVALID)
+	{
+		/* The count decides, also if the search ran out of budget */
+		engine_init(&w->engine, job->puzzle);
+		job->count = engine_count(&w->engine, options->count);
+		job->nodes = (long long)w->engine.nodes;
+		if (job->count > 0 && !job->found)
+		{
+			memcpy(job->solution, w->engine.solution,
+					sizeof(job->solution));
+			job->found = true;
+		}
+		job->status = (job->count == 0) ? ST_UNSOLVABLE :
+			(job->count > 1) ? ST_AMBIGUOUS : ST_SOLVED;
+	}
+	job->ns = now_ns() - t0;
+	atomic_store_explicit(&w->busy_since, 0, memory_order_relaxed);
+	atomic_store_explicit(&w->iterations, job->iterations +
+			atomic_load_explicit(&w->iterations, memory_order_relaxed),
+			memory_order_relaxed);
+	hist_add(&w->hist, job->ns);
+	slowest_add(&w->slowest, job->ns, job->index, job->puzzle);
+}
+
+static void run_jobs(Worker *w)
+{
+	size_t i;
+
+	while ((i = atomic_fetch_add_explicit(&next_job, 1,
+			memory_order_relaxed)) < num_jobs)
+	{
+		run_job(w, &jobs[i]);
+		atomic_store_explicit(&w->done, 1 +
+				atomic_load_explicit(&w->done, memory_order_relaxed),
+				memory_order_relaxed);
+	}
+}
+
+static void *worker_main(void *arg)
+{
+	Worker *w = arg;
+
+	for (;;)
+	{
+		pthread_barrier_wait(&barrier_start);
+		if (quit)
+		{
+			break;
+		}
+		run_jobs(w);
+		pthread_barrier_wait(&barrier_done);
+	}
+	return NULL;
+}
+
+/* Lets all workers, including the calling thread, process the chunk */
+static void run_chunk(void)
+{
+	atomic_store_explicit(&next_job, 0, memory_order_relaxed);
+	if (num_workers > 1)
+	{
+		pthread_barrier_wait(&barrier_start);
+		run_jobs(&workers[0]);
+		pthread_barrier_wait(&barrier_done);
+	}
+	else
+	{
+		run_jobs(&workers[0]);
+	}
+}
+
+/* Writes the result of a job as a record */
+static void write_record(const Job *job)
+{
+	char buf[RECORD_MAX];
+	Record r =
+	{
+		.index = job->index,
+		.puzzle = (job->status != ST_ERROR) ? job->puzzle : NULL,
+		.solution = (job->found || job->status == ST_REDUCED) ?
+			job->solution : NULL,
+		.status = status_names[job->status],
+		.count = job->count,
+		.nodes = job->nodes,
+		.iterations = job->iterations,
+		.ns = job->ns
+	};
+
+	fwrite(buf, 1, record_format(buf, options->format, &r), out);
+}
+
+static void write_results(size_t counts[])
+{
+	char buf[GRID_LINE_LEN + 1];
+	size_t i;
+
+	for (i = 0; i < num_jobs; i++)
+	{
+		counts[jobs[i].status]++;
+		if (options->quiet)
+		{
+			continue;
+		}
+		if (options->format != BF_TEXT)
+		{
+			write_record(&jobs[i]);
+		}
+		else if (jobs[i].status == ST_SOLVED ||
+				jobs[i].status == ST_REDUCED)
+		{
+			grid_format(jobs[i].solution, buf);
+			buf[GRID_LINE_LEN] = '\n';
+			fwrite(buf, 1, sizeof(buf), out);
+		}
+		else
+		{
+			fprintf(out, "%s\n", status_names[jobs[i].status]);
+		}
+	}
+}
+
+/* Merges the statistics of all workers */
+static void merge_stats(Hist *h, Slowest *sl)
+{
+	size_t i;
+
+	hist_init(h);
+	slowest_init(sl, options->slowest);
+	for (i = 0; i < num_workers; i++)
+	{
+		hist_merge(h, &workers[i].hist);
+		slowest_merge(sl, &workers[i].slowest);
+	}
+}
+
+/* Prints the counter values divided by the number of puzzles */
+static void print_perf(size_t puzzles)
+{
+	size_t i;
+
+	if (puzzles == 0)
+	{
+		return;
+	}
+	fprintf(stderr, "perf(per puzzle)");
+	for (i = 0; i < PC_NUM; i++)
+	{
+		if (perf.valid[i])
+			fprintf(stderr, " %s=%.0f", perf_counter_names[i],
+					(double)perf.value[i] / (double)puzzles);
+		else
+			fprintf(stderr, " %s=n/a", perf_counter_names[i]);
+	}
+	if (perf.valid[PC_CYCLES] && perf.valid[PC_INSTRUCTIONS] &&
+			perf.value[PC_CYCLES])
+	{
+		fprintf(stderr, " ipc=%.2f", (double)perf.value[PC_INSTRUCTIONS] /
+				(double)perf.value[PC_CYCLES]);
+	}
+	fputc('\n', stderr);
+}
+
+/* allocs is the number of allocations after the first chunk, or -1 if
+ * unknown
+ */
+static void print_stats(const size_t counts[], uint64_t ns, long allocs)
+{
+	Hist *h = &checkpoint.hist;
+	Slowest *sl = &checkpoint.slowest;
+	char buf[GRID_LINE_LEN + 1];
+	size_t i, total = 0, hits = 0;
+
+	merge_stats(h, sl);
+	slowest_sort(sl);
+
+	for (i = 0; i < ST_NUM; i++)
+	{
+		total += counts[i];
+	}
+	fprintf(stderr, "puzzles=%zu", total);
+	for (i = 0; i < ST_NUM; i++)
+	{
+		if (counts[i])
+			fprintf(stderr, " %s=%zu", status_names[i], counts[i]);
+	}
+	fprintf(stderr, "\ntime=%.3fs rate=%.1f/s threads=%zu\n",
+			(double)ns / 1e9,
+			ns ? (double)total * 1e9 / (double)ns : 0.0, num_workers);
+	if (store)
+	{
+		for (i = 0; i < num_workers; i++)
+		{
+			hits += workers[i].store_hits;
+		}
+		fprintf(stderr, "store hits=%zu\n", hits);
+	}
+	if (allocs >= 0)
+		fprintf(stderr, "allocs after warm-up=%ld\n", allocs);
+	else
+		fprintf(stderr, "allocs after warm-up=n/a\n");
+	if (h->count == 0)
+	{
+		return;
+	}
+	fprintf(stderr, "latency(us) min=%.1f mean=%.1f p50=%.1f p90=%.1f "
+			"p99=%.1f p99.9=%.1f max=%.1f\n",
+			(double)h->min / 1e3,
+			(double)h->sum / (double)h->count / 1e3,
+			(double)hist_percentile(h, 50.0) / 1e3,
+			(double)hist_percentile(h, 90.0) / 1e3,
+			(double)hist_percentile(h, 99.0) / 1e3,
+			(double)hist_percentile(h, 99.9) / 1e3,
+			(double)h->max / 1e3);
+	if (sl->num)
+	{
+		fprintf(stderr, "slowest:\n");
+	}
+	buf[GRID_LINE_LEN] = '\0';
+	for (i = 0; i < sl->num; i++)
+	{
+		grid_format(sl->entries[i].puzzle, buf);
+		fprintf(stderr, "%zu %.1fus %s\n", sl->entries[i].index,
+				(double)sl->entries[i].value / 1e3, buf);
+	}
+}
+
+/* Prints what the workers published: the number of puzzles done, and of
+ * those read but not yet done, the share of the input read, the rates of
+ * this run, and the puzzle that is in work for the longest time.
+ */
+static void report_progress(void *arg)
+{
+	Worker *w;
+	uint64_t now, ns, since, oldest = 0;
+	unsigned long long iterations = 0;
+	size_t i, done = 0, index = 0, read;
+
+	(void)arg;
+	for (i = 0; i < num_workers; i++)
+	{
+		w = &workers[i];
+		done += atomic_load_explicit(&w->done, memory_order_relaxed);
+		iterations += atomic_load_explicit(&w->iterations,
+				memory_order_relaxed);
+		since = atomic_load_explicit(&w->busy_since, memory_order_relaxed);
+		if (since && (oldest == 0 || since < oldest))
+		{
+			oldest = since;
+			index = atomic_load_explicit(&w->busy_index,
+					memory_order_relaxed);
+		}
+	}
+	read = atomic_load_explicit(&records_read, memory_order_relaxed);
+	now = now_ns();
+	ns = now - run_start;
+	fprintf(stderr, "progress done=%zu queued=%zu", records_resumed + done,
+			(read > done) ? read - done : 0);
+	if (input_total > 0)
+	{
+		fprintf(stderr, " input=%.1f%%", 100.0 * (double)atomic_load_explicit(
+				&input_pos, memory_order_relaxed) / (double)input_total);
+	}
+	fprintf(stderr, " time=%.3fs rate=%.1f/s iterations=%.0f/s",
+			(double)ns / 1e9, ns ? (double)done * 1e9 / (double)ns : 0.0,
+			ns ? (double)iterations * 1e9 / (double)ns : 0.0);
+	if (oldest && now > oldest)
+	{
+		fprintf(stderr, " in-flight=%zu %.1fus", index,
+				(double)(now - oldest) / 1e3);
+	}
+	fputc('\n', stderr);
+}
+
+static int start_workers(void)
+{
+	size_t i;
+	long cpus;
+
+	num_workers = options->threads;
+	if (num_workers == 0)
+	{
+		cpus = sysconf(_SC_NPROCESSORS_ONLN);
+		num_workers = (cpus > 0) ? (size_t)cpus : 1;
+	}
+	workers = aligned_alloc(WORKER_ALIGN, num_workers * sizeof(*workers));
+	if (!workers)
+	{
+		perror("aligned_alloc");
+		return -1;
+	}
+	memset(workers, 0, num_workers * sizeof(*workers));
+	for (i = 0; i < num_workers; i++)
+	{
+		hist_init(&workers[i].hist);
+		slowest_init(&workers[i].slowest, options->slowest);
+	}
+	/* Before the threads, so that they do not take SIGUSR1 */
+	if (progress_start(&progress, options->progress_interval,
+			report_progress, NULL) < 0)
+	{
+		free(workers);
+		workers = NULL;
+		return -1;
+	}
+	if (num_workers == 1)
+	{
+		return 0;
+	}
+	pthread_barrier_init(&barrier_start, NULL, (unsigned)num_workers);
+	pthread_barrier_init(&barrier_done, NULL, (unsigned)num_workers);
+	/* workers[0] is the calling thread */
+	for (i = 1; i < num_workers; i++)
+	{
+		if (pthread_create(&workers[i].thread, NULL, worker_main,
+				&workers[i]) != 0)
+		{
+			/* Fatal: the barriers count on all threads */
+			perror("pthread_create");
+			return -1;
+		}
+	}
+	return 0;
+}
+
+static void stop_workers(void)
+{
+	size_t i;
+
+	progress_stop(&progress);
+	if (num_workers > 1)
+	{
+		quit = true;
+		pthread_barrier_wait(&barrier_start);
+		for (i = 1; i < num_workers; i++)
+		{
+			pthread_join(workers[i].thread, NULL);
+		}
+		pthread_barrier_destroy(&barrier_start);
+		pthread_barrier_destroy(&barrier_done);
+	}
+	free(workers);
+	workers = NULL;
+}
+
+static void handle_signal(int signum)
+{
+	(void)signum;
+	interrupted = 1;
+}
+
+/* Writes the output and then the checkpoint to disk.
+ * Returns 0 on success, else -1.
+ */
+static int save_checkpoint(Input *in, size_t index, const size_t counts[],
+		uint64_t elapsed_ns)
+{
+	Checkpoint *cp = &checkpoint;
+
+	if (fflush(out) == EOF || (options->output && fsync(fileno(out)) == -1))
+	{
+		perror("fsync");
+		return -1;
+	}
+	cp->mode = options->mode;
+	cp->format = options->format;
+	cp->shard = options->shard;
+	cp->num_shards = options->num_shards;
+	cp->count = options->count;
+	cp->budget = options->budget;
+	/* Too long a path would not have opened */
+	snprintf(cp->store, sizeof(cp->store), "%s", store ? options->store : "");
+	input_tell(in, &cp->file, &cp->offset);
+	cp->record = index;
+	cp->output = options->output ? ftello(out) : 0;
+	cp->elapsed_ns = elapsed_ns;
+	memcpy(cp->counts, counts, sizeof(cp->counts));
+	merge_stats(&cp->hist, &cp->slowest);
+	return checkpoint_write(options->checkpoint, cp);
+}
+
+/* Continues where the checkpoint left off, if there is one. The inputs
+ * of this run must have been set in checkpoint already.
+ * Returns 0 on success, else -1.
+ */
+static int load_checkpoint(Input *in, size_t *index, size_t counts[],
+		uint64_t *elapsed_ns)
+{
+	static Checkpoint saved;
+	Checkpoint *cp = &saved;
+	int ret;
+
+	ret = checkpoint_read(options->checkpoint, cp);
+	if (ret == 1)
+	{
+		/* Nothing to resume, start from the beginning */
+		if (options->output && ftruncate(fileno(out), 0) == -1)
+		{
+			perror(options->output);
+			return -1;
+		}
+		return 0;
+	}
+	if (ret < 0)
+	{
+		return -1;
+	}
+	if (cp->mode != options->mode || cp->format != options->format ||
+			cp->shard != options->shard ||
+			cp->num_shards != options->num_shards ||
+			cp->count != options->count || cp->budget != options->budget ||
+			strcmp(cp->store, store ? options->store : "") != 0)
+	{
+		fprintf(stderr, "%s: Error: Checkpoint is from a different run!\n",
+				options->checkpoint);
+		ret = -1;
+	}
+	else if (!checkpoint_same_inputs(cp, &checkpoint))
+	{
+		fprintf(stderr, "%s: Error: Input files differ from the "
+				"checkpoint or have changed!\n", options->checkpoint);
+		ret = -1;
+	}
+	else if (options->output &&
+			(ftruncate(fileno(out), cp->output) == -1 ||
+			 fseeko(out, cp->output, SEEK_SET) == -1))
+	{
+		perror(options->output);
+		ret = -1;
+	}
+	else if (input_seek(in, cp->file, cp->offset) < 0)
+	{
+		ret = -1;
+	}
+	else
+	{
+		*index = cp->record;
+		memcpy(counts, cp->counts, sizeof(cp->counts));
+		*elapsed_ns = cp->elapsed_ns;
+		hist_merge(&workers[0].hist, &cp->hist);
+		slowest_merge(&workers[0].slowest, &cp->slowest);
+	}
+	checkpoint_free(cp);
+	return ret;
+}
+
+/* A resumed run seeks to the saved position, so all inputs must be
+ * regular files. Checked before anything is written.
+ * Returns 0 on success, else -1.
+ */
+static int check_resume(void)
+{
+	const Checkpoint_Input *f;
+	size_t i;
+
+	for (i = 0; i < checkpoint.num_inputs; i++)
+	{
+		f = &checkpoint.inputs[i];
+		if (f->size < 0)
+		{
+			fprintf(stderr, "%s: Error: Cannot resume, not a regular "
+					"file!\n", strcmp(f->path, "-") ? f->path : "STDIN");
+			return -1;
+		}
+	}
+	return 0;
+}
+
+static int open_output(void)
+{
+	static char output_buffer[OUTPUT_BUFFER_SIZE];
+
+	out = stdout;
+	if (options->output)
+	{
+		/* Keep the previous output when resuming, it is truncated to
+		 * the size recorded in the checkpoint.
+		 */
+		out = fopen(options->output, options->resume ? "a+" : "w");
+		if (!out)
+		{
+			perror(options->output);
+			return -1;
+		}
+	}
+	setvbuf(out, output_buffer, _IOFBF, sizeof(output_buffer));
+	return 0;
+}
+
+int batch_run(const Batch_Options *opt, char *files[], int num_files)
+{
+	Input in = { .files = files, .num_files = num_files };
+	size_t counts[ST_NUM] = { 0 };
+	size_t index = 0;
+	ssize_t len;
+	uint64_t t0, elapsed_ns = 0, last_checkpoint;
+	struct sigaction sigact;
+	Job *job;
+	size_t total = 0, total_resumed = 0, i;
+	bool use_perf = false;
+	/* Allocations until the end of the first chunk */
+	long warm_allocs = -1, allocs = -1;
+	int ret = 0;
+
+	options = opt;
+	if (options->checkpoint && (checkpoint_set_inputs(&checkpoint, files,
+			(size_t)num_files) < 0 || (options->resume && check_resume() < 0)))
+	{
+		checkpoint_free(&checkpoint);
+		return 1;
+	}
+	if (options->store && options->mode == BM_SOLVE)
+	{
+		if (hashdb_open(&db, options->store, false) != 0)
+		{
+			perror(options->store);
+			return 1;
+		}
+		store = true;
+	}
+	if (open_output() < 0)
+	{
+		return 1;
+	}
+	search_setup();
+	engine_setup();
+	if (options->perf)
+	{
+		/* Before the threads are created, so that they inherit the
+		 * counters.
+		 */
+		if (perf_open(&perf) > 0)
+		{
+			use_perf = true;
+		}
+		else
+		{
+			fprintf(stderr, "perf: counters unavailable: %s\n",
+					strerror(errno));
+		}
+	}
+	if (start_workers() < 0)
+	{
+		return 1;
+	}
+	if (options->checkpoint)
+	{
+		memset(&sigact, 0, sizeof(sigact));
+		sigact.sa_handler = handle_signal;
+		sigaction(SIGINT, &sigact, NULL);
+		sigaction(SIGTERM, &sigact, NULL);
+		if (options->resume &&
+				load_checkpoint(&in, &index, counts, &elapsed_ns) < 0)
+		{
+			in.error = 1;
+		}
+	}
+	for (i = 0; i < ST_NUM; i++)
+	{
+		total_resumed += counts[i];
+	}
+	input_total = input_size(&in);
+	records_resumed = total_resumed;
+	run_start = now_ns();
+	t0 = now_ns() - elapsed_ns;
+	last_checkpoint = now_ns();
+	if (use_perf)
+	{
+		perf_start(&perf);
+	}
+	/* The header is not a record, and would be taken for one when
+	 * merging shards
+	 */
+	if (options->format == BF_CSV && !options->quiet &&
+			!options->num_shards && index == 0 && !in.error)
+	{
+		fputs(record_csv_header, out);
+	}
+	num_jobs = in.error ? 0 : BATCH_CHUNK;
+	while (num_jobs == BATCH_CHUNK)
+	{
+		num_jobs = 0;
+		while (num_jobs < BATCH_CHUNK)
+		{
+			len = input_read_line(&in);
+			if (len == -1)
+			{
+				break;
+			}
+			if (options->num_shards &&
+					index % options->num_shards != options->shard)
+			{
+				index++;
+				continue;
+			}
+			job = &jobs[num_jobs++];
+			job->index = index++;
+			job->found = false;
+			job->count = -1;
+			job->nodes = -1;
+			job->iterations = 0;
+			job->ns = 0;
+			job->status = (grid_parse(job->puzzle, in.line,
+					(size_t)len) == 0) ? ST_SOLVED : ST_ERROR;
+		}
+		atomic_store_explicit(&records_read, num_jobs +
+				atomic_load_explicit(&records_read, memory_order_relaxed),
+				memory_order_relaxed);
+		atomic_store_explicit(&input_pos, (long long)(in.before +
+				(in.fp ? ftello(in.fp) : 0)), memory_order_relaxed);
+		run_chunk();
+		write_results(counts);
+		if (warm_allocs < 0)
+		{
+			warm_allocs = alloc_count();
+		}
+
+		if (options->checkpoint && num_jobs == BATCH_CHUNK &&
+				(interrupted || now_ns() - last_checkpoint >=
+				 (uint64_t)options->checkpoint_interval * 1000000000u))
+		{
+			if (save_checkpoint(&in, index, counts, now_ns() - t0) < 0)
+			{
+				in.error = 1;
+				break;
+			}
+			last_checkpoint = now_ns();
+			if (interrupted)
+			{
+				fprintf(stderr, "Interrupted after %zu records, "
+						"checkpoint written to `%s'\n", index,
+						options->checkpoint);
+				ret = 1;
+				break;
+			}
+		}
+	}
+
+	if (use_perf)
+	{
+		perf_stop(&perf);
+	}
+	if (options->num_shards && !options->quiet && !in.error && ret == 0)
+	{
+		fprintf(out, SHARD_TRAILER " %zu/%zu records=%zu\n",
+				options->shard + 1, options->num_shards, index);
+	}
+	if (fflush(out) == EOF)
+	{
+		perror("fflush");
+		in.error = 1;
+	}
+	if (warm_allocs >= 0)
+	{
+		allocs = alloc_count() - warm_allocs;
+	}
+	if (options->stats && ret == 0)
+	{
+		print_stats(counts, now_ns() - t0, allocs);
+	}
+	if (use_perf)
+	{
+		if (ret == 0)
+		{
+			/* Only the puzzles of this run were counted */
+			for (i = 0; i < ST_NUM; i++)
+			{
+				total += counts[i];
+			}
+			print_perf(total - total_resumed);
+		}
+		perf_close(&perf);
+	}
+	stop_workers();
+	if (store)
+	{
+		hashdb_close(&db);
+	}
+	if (in.file)
+	{
+		fclose(in.file);
+	}
+	if (out != stdout && fclose(out) == EOF)
+	{
+		perror(options->output);
+		in.error = 1;
+	}
+	if (options->checkpoint && !in.error && ret == 0)
+	{
+		/* The run is complete, a later --resume starts over */
+		unlink(options->checkpoint);
+	}
+	checkpoint_free(&checkpoint);
+
+	if (in.error || ret)
+		return 1;
+	if (counts[ST_INVALID] || counts[ST_ERROR])
+		return 2;
+	if (counts[ST_UNSOLVABLE] || counts[ST_AMBIGUOUS] ||
+			counts[ST_REDUNDANT] || counts[ST_BUDGET])
+		return 3;
+	return 0;
+}
@@ -0,0 +1,110 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright (c) 2023 Rainer Holzner <rholzner@web.de> */
+
+#ifndef _BATCH_H_
+#define _BATCH_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/* Last line of the output of a complete shard, followed by
+ * " K/N records=T" where T is the number of records in the whole input.
+ */
+#define SHARD_TRAILER "#shard"
+
+/* Result of one input line */
+typedef enum _status
+{
+	ST_SOLVED,
+	ST_COMPLETE,
+	ST_PARTIAL,
+	ST_INVALID,
+	ST_UNSOLVABLE,
+	ST_ERROR,
+	/* Of the reduce and minimal modes */
+	ST_REDUCED,
+	ST_MINIMAL,
+	ST_REDUNDANT,
+	ST_AMBIGUOUS,
+	/* The search took more iterations than allowed */
+	ST_BUDGET,
+	ST_NUM
+} Status;
+
+typedef enum _batch_mode
+{
+	BM_SOLVE,
+	BM_CHECK,
+	/* Remove clues while the solution stays unique */
+	BM_REDUCE,
+	/* Check that no clue can be removed */
+	BM_MINIMAL
+} Batch_Mode;
+
+/* Format of the result lines */
+typedef enum _batch_format
+{
+	/* The solution or the status */
+	BF_TEXT,
+	/* One JSON object per line */
+	BF_JSONL,
+	/* Comma separated values with a header line */
+	BF_CSV
+} Batch_Format;
+
+typedef struct _batch_options
+{
+	Batch_Mode mode;
+	/* Do not write any results (benchmark) */
+	bool quiet;
+	/* Print latency statistics to stderr when done */
+	bool stats;
+	/* Number of threads, 0 means one per online CPU */
+	size_t threads;
+	/* Number of slowest puzzles to report */
+	size_t slowest;
+	/* If num_shards > 0, only records whose index modulo num_shards
+	 * equals shard (counting from 0) are processed.
+	 */
+	size_t shard, num_shards;
+	/* Write results to this file instead of stdout, may be NULL */
+	const char *output;
+	/* Save the progress to this file, may be NULL */
+	const char *checkpoint;
+	/* Seconds between two checkpoints */
+	unsigned checkpoint_interval;
+	/* Continue from the checkpoint file, if it exists */
+	bool resume;
+	/* Read hardware performance counters around the run */
+	bool perf;
+	/* Look puzzles up in this store before solving them, may be NULL */
+	const char *store;
+	Batch_Format format;
+	/* Maximum number of search iterations per puzzle, 0 means none */
+	size_t budget;
+	/* Count the solutions of each puzzle up to this number, 0 means
+	 * they are not counted.
+	 */
+	int count;
+	/* Seconds between two progress reports, 0 means only on SIGUSR1 */
+	unsigned progress_interval;
+} Batch_Options;
+
+/* Processes one puzzle per line from the given files, or stdin if
+ * there are none, and writes one result line per input line to stdout.
+ * In shard mode, only the lines of the shard are processed and a
+ * SHARD_TRAILER line is written after the last one.
+ * With a checkpoint file, the progress is saved periodically and on
+ * SIGINT or SIGTERM, and the file is removed when the run is complete.
+ * The progress is printed to stderr on SIGUSR1 and periodically with a
+ * progress interval.
+ *
+ * Returns the exit status of the solver: 0 if all puzzles were solved
+ * or valid, 1 on I/O errors, 2 if at least one line was invalid or
+ * malformed, otherwise 3 if at least one puzzle has no solution, more
+ * than one if they are counted, was not solved within the budget, or in
+ * the reduce and minimal modes, no unique solution or is not minimal.
+ */
+int batch_run(const Batch_Options *opt, char *files[], int num_files);
+
+#endif
@@ -0,0 +1,92 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright (c) 2023 Rainer Holzner <rholzner@web.de> */
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "bg.h"
+
+static void *bg_main(void *arg)
+{
+	Bg_Job *job = arg;
+
+	job->func(job);
+	atomic_store_explicit(&job->done, true, memory_order_release);
+	if (write(job->wake_fd[1], "", 1) == -1)
+	{
+		/* The owner notices on its next bg_done() call anyway */
+	}
+	return NULL;
+}
+
+int bg_start(Bg_Job *job, Bg_Func func, void *arg)
+{
+	if (job->running)
+	{
+		return -1;
+	}
+	job->func = func;
+	job->arg = arg;
+	atomic_store(&job->cancel, false);
+	atomic_store(&job->done, false);
+	atomic_store(&job->progress, 0);
+	if (pipe(job->wake_fd) == -1)
+	{
+		perror("pipe");
+		return -1;
+	}
+	if (pthread_create(&job->thread, NULL, bg_main, job) != 0)
+	{
+		perror("pthread_create");
+		close(job->wake_fd[0]);
+		close(job->wake_fd[1]);
+		return -1;
+	}
+	job->running = true;
+	return 0;
+}
+
+bool bg_done(Bg_Job *job)
+{
+	return job->running &&
+		atomic_load_explicit(&job->done, memory_order_acquire);
+}
+
+int bg_fd(Bg_Job *job)
+{
+	return job->running ? job->wake_fd[0] : -1;
+}
+
+void bg_join(Bg_Job *job)
+{
+	if (job->running)
+	{
+		pthread_join(job->thread, NULL);
+		close(job->wake_fd[0]);
+		close(job->wake_fd[1]);
+		job->running = false;
+	}
+}
+
+void bg_cancel(Bg_Job *job)
+{
+	atomic_store_explicit(&job->cancel, true, memory_order_relaxed);
+	bg_join(job);
+}
+
+bool bg_cancelled(Bg_Job *job)
+{
+	return atomic_load_explicit(&job->cancel, memory_order_relaxed);
+}
+
+void bg_progress(Bg_Job *job, size_t progress)
+{
+	atomic_store_explicit(&job->progress, progress, memory_order_relaxed);
+}
+
+size_t bg_get_progress(Bg_Job *job)
+{
+	return atomic_load_explicit(&job->progress, memory_order_relaxed);
+}
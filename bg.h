@@ -0,0 +1,51 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright (c) 2023 Rainer Holzner <rholzner@web.de> */
+
+#ifndef _BG_H_
+#define _BG_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdatomic.h>
+#include <pthread.h>
+
+typedef struct _bg_job Bg_Job;
+typedef void (*Bg_Func)(Bg_Job *job);
+
+/* A function running in a background thread.
+ * The function should check bg_cancelled() regularly and publish its
+ * progress with bg_progress().
+ */
+struct _bg_job
+{
+	pthread_t thread;
+	Bg_Func func;
+	void *arg;
+	atomic_bool cancel;
+	atomic_bool done;
+	atomic_size_t progress;
+	/* Becomes readable when the function has returned */
+	int wake_fd[2];
+	/* The thread has been started but not joined yet */
+	bool running;
+};
+
+/* Returns 0 on success, else -1. */
+int bg_start(Bg_Job *job, Bg_Func func, void *arg);
+/* Returns true if the function has returned. Does not block. */
+bool bg_done(Bg_Job *job);
+/* File descriptor for poll() that becomes readable when the function
+ * has returned, or -1 if the job is not running.
+ */
+int bg_fd(Bg_Job *job);
+/* Waits for the function to return */
+void bg_join(Bg_Job *job);
+/* Asks the function to stop and waits for it */
+void bg_cancel(Bg_Job *job);
+
+/* For the function */
+bool bg_cancelled(Bg_Job *job);
+void bg_progress(Bg_Job *job, size_t progress);
+size_t bg_get_progress(Bg_Job *job);
+
+#endif
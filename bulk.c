@@ -0,0 +1,284 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright (c) 2023 Rainer Holzner <rholzner@web.de> */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include "grid.h"
+#include "engine.h"
+#include "bulk.h"
+
+static const char *results[] = { "no solution", "unique", "not unique" };
+
+static int compare_items(const void *a, const void *b)
+{
+	return strcmp(((const Bulk_Item *)a)->name, ((const Bulk_Item *)b)->name);
+}
+
+int bulk_init(Bulk *b, const char *dir)
+{
+	Bulk_Item *p;
+	struct dirent *de;
+	struct stat st;
+	size_t capacity = 0;
+	DIR *d;
+	int err;
+
+	memset(b, 0, sizeof(*b));
+	b->dir_fd = -1;
+	if (strlen(dir) >= sizeof(b->dir))
+	{
+		errno = ENAMETOOLONG;
+		return -1;
+	}
+	strcpy(b->dir, dir);
+	d = opendir(dir);
+	if (d == NULL)
+	{
+		return -1;
+	}
+	while ((de = readdir(d)) != NULL)
+	{
+		/* Hidden files, and the results of an earlier run */
+		if (de->d_name[0] == '.' || strcmp(de->d_name, BULK_SUMMARY) == 0 ||
+			fstatat(dirfd(d), de->d_name, &st, 0) == -1 ||
+			!S_ISREG(st.st_mode))
+		{
+			continue;
+		}
+		if (b->num == capacity)
+		{
+			capacity = capacity ? capacity * 2 : 256;
+			p = realloc(b->items, capacity * sizeof(*p));
+			if (p == NULL)
+			{
+				goto fail;
+			}
+			b->items = p;
+		}
+		p = &b->items[b->num];
+		p->name = strdup(de->d_name);
+		if (p->name == NULL)
+		{
+			goto fail;
+		}
+		p->found = BULK_PENDING;
+		b->num++;
+	}
+	/* Kept open so that the workers find the files by name */
+	b->dir_fd = dup(dirfd(d));
+	if (b->dir_fd == -1)
+	{
+		goto fail;
+	}
+	closedir(d);
+	qsort(b->items, b->num, sizeof(*b->items), compare_items);
+	atomic_init(&b->next, 0);
+	atomic_init(&b->done, 0);
+	return 0;
+
+fail:
+	err = errno;
+	closedir(d);
+	bulk_free(b);
+	errno = err;
+	return -1;
+}
+
+void bulk_free(Bulk *b)
+{
+	size_t i;
+
+	for (i = 0; i < b->num; i++)
+	{
+		free(b->items[i].name);
+	}
+	free(b->items);
+	if (b->dir_fd != -1)
+	{
+		close(b->dir_fd);
+	}
+	b->items = NULL;
+	b->num = 0;
+	b->dir_fd = -1;
+}
+
+static bool cancelled(const Bulk *b)
+{
+	return b->cancel &&
+		atomic_load_explicit(b->cancel, memory_order_relaxed);
+}
+
+/* Reads the puzzle on the first line of a file.
+ * Returns 0 on success, else -1.
+ */
+static int read_puzzle(const Bulk *b, const char *name, Grid g)
+{
+	char line[256];
+	FILE *fp;
+	int fd, ret = -1;
+
+	fd = openat(b->dir_fd, name, O_RDONLY);
+	if (fd == -1)
+	{
+		return -1;
+	}
+	fp = fdopen(fd, "r");
+	if (fp == NULL)
+	{
+		close(fd);
+		return -1;
+	}
+	if (fgets(line, sizeof(line), fp) &&
+		grid_parse(g, line, strlen(line)) == 0)
+	{
+		ret = 0;
+	}
+	fclose(fp);
+	return ret;
+}
+
+static void *worker_main(void *arg)
+{
+	Bulk *b = arg;
+	Bulk_Item *item;
+	Engine *e;
+	Grid g;
+	size_t i;
+	int n;
+
+	/* Too large for the stack of a thread on some systems */
+	e = malloc(sizeof(*e));
+	if (e == NULL)
+	{
+		return NULL;
+	}
+	e->cancel = b->cancel;
+	while (!cancelled(b))
+	{
+		i = atomic_fetch_add_explicit(&b->next, 1, memory_order_relaxed);
+		if (i >= b->num)
+		{
+			break;
+		}
+		item = &b->items[i];
+		if (read_puzzle(b, item->name, g) != 0)
+		{
+			n = BULK_NOT_PUZZLE;
+		}
+		else if (engine_init(e, g) != 0)
+		{
+			n = 0;
+		}
+		else
+		{
+			n = engine_count(e, 2);
+			if (n < 0)
+			{
+				/* Cancelled */
+				break;
+			}
+			memcpy(item->solution, e->solution, sizeof(item->solution));
+		}
+		item->found = (signed char)n;
+		atomic_fetch_add_explicit(&b->done, 1, memory_order_release);
+	}
+	free(e);
+	return NULL;
+}
+
+int bulk_run(Bulk *b)
+{
+	pthread_t *threads;
+	size_t num_threads = b->threads, started = 0, i;
+	long cpus;
+
+	if (num_threads == 0)
+	{
+		cpus = sysconf(_SC_NPROCESSORS_ONLN);
+		num_threads = (cpus > 0) ? (size_t)cpus : 1;
+	}
+	threads = calloc(num_threads, sizeof(*threads));
+	if (threads)
+	{
+		/* The calling thread is the first worker */
+		for (i = 1; i < num_threads; i++)
+		{
+			if (pthread_create(&threads[i], NULL, worker_main, b) != 0)
+			{
+				/* The others take over its share */
+				break;
+			}
+			started++;
+		}
+	}
+	worker_main(b);
+	for (i = 1; i <= started; i++)
+	{
+		pthread_join(threads[i], NULL);
+	}
+	free(threads);
+	return (atomic_load(&b->done) == b->num) ? 0 : -1;
+}
+
+void bulk_count(const Bulk *b, size_t counts[4])
+{
+	size_t i;
+
+	counts[0] = counts[1] = counts[2] = counts[3] = 0;
+	for (i = 0; i < b->num; i++)
+	{
+		if (b->items[i].found == BULK_NOT_PUZZLE)
+			counts[3]++;
+		else if (b->items[i].found >= 0)
+			counts[(int)b->items[i].found]++;
+	}
+}
+
+int bulk_write_summary(const Bulk *b, const char *path, double seconds)
+{
+	char solution[GRID_LINE_LEN + 1];
+	const Bulk_Item *item;
+	size_t counts[4], i;
+	FILE *fp;
+	int ret = 0;
+
+	fp = fopen(path, "w");
+	if (fp == NULL)
+	{
+		return -1;
+	}
+	bulk_count(b, counts);
+	/* The first line is not a puzzle, so the library skips this file */
+	fprintf(fp, "# %zu puzzles in %.3fs: %zu unique, %zu not unique, "
+			"%zu no solution\n", counts[0] + counts[1] + counts[2], seconds,
+			counts[1], counts[2], counts[0]);
+	solution[GRID_LINE_LEN] = '\0';
+	for (i = 0; i < b->num; i++)
+	{
+		item = &b->items[i];
+		if (item->found < 0)
+		{
+			continue;
+		}
+		if (item->found > 0)
+			grid_format(item->solution, solution);
+		fprintf(fp, "%s\t%s\t%s\n", item->name, results[(int)item->found],
+				(item->found > 0) ? solution : "-");
+	}
+	if (ferror(fp))
+	{
+		ret = -1;
+	}
+	if (fclose(fp) == EOF)
+	{
+		ret = -1;
+	}
+	return ret;
+}
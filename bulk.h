@@ -0,0 +1,67 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright (c) 2023 Rainer Holzner <rholzner@web.de> */
+
+#ifndef _BULK_H_
+#define _BULK_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdatomic.h>
+#include <limits.h>
+#include "grid.h"
+
+/* Name of the summary file written into the directory */
+#define BULK_SUMMARY "solve-summary.txt"
+
+/* Results besides the number of solutions */
+#define BULK_PENDING (-1)
+#define BULK_NOT_PUZZLE (-2)
+
+typedef struct _bulk_item
+{
+	char *name;
+	/* Solutions found: 0, 1, or 2 for two or more */
+	signed char found;
+	/* The first one found */
+	Grid solution;
+} Bulk_Item;
+
+/* Solves and validates the puzzles of all files in a directory */
+typedef struct _bulk
+{
+	char dir[PATH_MAX];
+	int dir_fd;
+	Bulk_Item *items;
+	size_t num;
+	/* 0 for one per CPU */
+	size_t threads;
+	/* Next item to take, and items done */
+	atomic_size_t next;
+	atomic_size_t done;
+	/* bulk_run() stops soon after it becomes true. May be NULL. */
+	atomic_bool *cancel;
+} Bulk;
+
+/* Lists the files of dir, like the library does.
+ * Returns 0 on success, else -1 with errno set.
+ */
+int bulk_init(Bulk *b, const char *dir);
+void bulk_free(Bulk *b);
+
+/* Reads and solves the files, the calling thread among the workers.
+ * Returns 0 when all are done, -1 if cancelled.
+ */
+int bulk_run(Bulk *b);
+
+/* Counts the items by result: counts[0] no solution, counts[1] unique,
+ * counts[2] not unique, counts[3] not a puzzle
+ */
+void bulk_count(const Bulk *b, size_t counts[4]);
+
+/* Writes a comment line with the counts, then one line per puzzle:
+ * name, result and solution, tab separated.
+ * Returns 0 on success, else -1 with errno set.
+ */
+int bulk_write_summary(const Bulk *b, const char *path, double seconds);
+
+#endif
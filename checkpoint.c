@@ -0,0 +1,332 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright (c) 2023 Rainer Holzner <rholzner@web.de> */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <inttypes.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "checkpoint.h"
+#include "grid.h"
+
+#define LEN(s) (sizeof(s)-1)
+#define CHECKPOINT_MAGIC "sudoku-checkpoint 5"
+#define TEMP_SUFFIX ".tmp"
+
+/* The checkpoint is a text file with one "key values" pair per line.
+ * The "files" line is followed by one "file" line per input, with the
+ * path last, and the "store" line, if any, ends with the path, too. Only non-empty histogram buckets are written. The last line is
+ * "end", so a truncated file is never mistaken for a checkpoint.
+ */
+static int fwrite_checkpoint(FILE *fp, const Checkpoint *cp)
+{
+	char puzzle[GRID_LINE_LEN + 1];
+	const Slow_Entry *e;
+	const Checkpoint_Input *f;
+	size_t i;
+
+	/* The path ends the line of the store */
+	if (strchr(cp->store, '\n'))
+	{
+		errno = EINVAL;
+		return -1;
+	}
+	fprintf(fp, CHECKPOINT_MAGIC "\n");
+	fprintf(fp, "mode %d\n", (int)cp->mode);
+	fprintf(fp, "format %d\n", (int)cp->format);
+	fprintf(fp, "shard %zu %zu\n", cp->shard, cp->num_shards);
+	fprintf(fp, "count %d\n", cp->count);
+	fprintf(fp, "budget %zu\n", cp->budget);
+	if (cp->store[0] != '\0')
+	{
+		fprintf(fp, "store %s\n", cp->store);
+	}
+	fprintf(fp, "files %zu\n", cp->num_inputs);
+	for (i = 0; i < cp->num_inputs; i++)
+	{
+		f = &cp->inputs[i];
+		fprintf(fp, "file %jd %jd %s\n", (intmax_t)f->size,
+				(intmax_t)f->mtime, f->path);
+	}
+	fprintf(fp, "input %zu %jd\n", cp->file, (intmax_t)cp->offset);
+	fprintf(fp, "record %zu\n", cp->record);
+	fprintf(fp, "output %jd\n", (intmax_t)cp->output);
+	fprintf(fp, "elapsed %" PRIu64 "\n", cp->elapsed_ns);
+	fprintf(fp, "counts");
+	for (i = 0; i < ST_NUM; i++)
+	{
+		fprintf(fp, " %zu", cp->counts[i]);
+	}
+	fprintf(fp, "\nhist %" PRIu64 " %" PRIu64 " %" PRIu64 " %" PRIu64 "\n",
+			cp->hist.count, cp->hist.sum, cp->hist.min, cp->hist.max);
+	for (i = 0; i < HIST_BUCKETS; i++)
+	{
+		if (cp->hist.buckets[i])
+		{
+			fprintf(fp, "bucket %zu %" PRIu64 "\n", i, cp->hist.buckets[i]);
+		}
+	}
+	puzzle[GRID_LINE_LEN] = '\0';
+	for (i = 0; i < cp->slowest.num; i++)
+	{
+		e = &cp->slowest.entries[i];
+		grid_format(e->puzzle, puzzle);
+		fprintf(fp, "slow %" PRIu64 " %zu %s\n", e->value, e->index, puzzle);
+	}
+	fprintf(fp, "end\n");
+	return ferror(fp) ? -1 : 0;
+}
+
+int checkpoint_write(const char *path, const Checkpoint *cp)
+{
+	char temp[PATH_MAX];
+	FILE *fp;
+	int ret;
+
+	if ((size_t)snprintf(temp, sizeof(temp), "%s" TEMP_SUFFIX, path) >=
+			sizeof(temp))
+	{
+		errno = ENAMETOOLONG;
+		perror(path);
+		return -1;
+	}
+	fp = fopen(temp, "w");
+	if (!fp)
+	{
+		perror(temp);
+		return -1;
+	}
+	ret = fwrite_checkpoint(fp, cp);
+	if (fflush(fp) == EOF || fsync(fileno(fp)) == -1)
+	{
+		ret = -1;
+	}
+	if (fclose(fp) == EOF)
+	{
+		ret = -1;
+	}
+	if (ret == 0 && rename(temp, path) == -1)
+	{
+		ret = -1;
+	}
+	if (ret != 0)
+	{
+		perror(temp);
+		unlink(temp);
+	}
+	return ret;
+}
+
+int checkpoint_read(const char *path, Checkpoint *cp)
+{
+	char line[PATH_MAX + 64];
+	char puzzle[GRID_LINE_LEN + 1];
+	intmax_t offset, output, size, mtime;
+	size_t i, bucket, num_inputs = 0;
+	uint64_t value;
+	Slow_Entry *e;
+	Checkpoint_Input *f;
+	FILE *fp;
+	char *p;
+	int mode, format, n = 0;
+	/* -1: invalid, 0: reading, 1: complete */
+	int ok = -1;
+
+	fp = fopen(path, "r");
+	if (!fp)
+	{
+		if (errno == ENOENT)
+		{
+			return 1;
+		}
+		perror(path);
+		return -1;
+	}
+	memset(cp, 0, sizeof(*cp));
+	hist_init(&cp->hist);
+	slowest_init(&cp->slowest, SLOWEST_MAX);
+
+	if (fgets(line, sizeof(line), fp) &&
+			strcmp(line, CHECKPOINT_MAGIC "\n") == 0)
+	{
+		ok = 0;
+	}
+	while (ok == 0 && fgets(line, sizeof(line), fp))
+	{
+		if (sscanf(line, "mode %d", &mode) == 1)
+		{
+			cp->mode = (Batch_Mode)mode;
+		}
+		else if (sscanf(line, "format %d", &format) == 1)
+		{
+			cp->format = (Batch_Format)format;
+		}
+		else if (sscanf(line, "files %zu", &i) == 1)
+		{
+			/* Once, before the file lines */
+			if (cp->inputs || !(cp->inputs = calloc(i ? i : 1, sizeof(*f))))
+				ok = -1;
+			else
+				cp->num_inputs = i;
+		}
+		else if (sscanf(line, "file %jd %jd%n", &size, &mtime, &n) == 2 &&
+				line[n] == ' ' && num_inputs < cp->num_inputs)
+		{
+			f = &cp->inputs[num_inputs++];
+			f->size = (off_t)size;
+			f->mtime = (int64_t)mtime;
+			line[strcspn(line, "\n")] = '\0';
+			if (!(f->path = strdup(line + n + 1)))
+				ok = -1;
+		}
+		else if (strncmp(line, "store ", LEN("store ")) == 0)
+		{
+			line[strcspn(line, "\n")] = '\0';
+			if (strlen(line + LEN("store ")) < sizeof(cp->store))
+				strcpy(cp->store, line + LEN("store "));
+			else
+				ok = -1;
+		}
+		else if (sscanf(line, "shard %zu %zu", &cp->shard,
+				&cp->num_shards) == 2 ||
+				sscanf(line, "count %d", &cp->count) == 1 ||
+				sscanf(line, "budget %zu", &cp->budget) == 1 ||
+				sscanf(line, "record %zu", &cp->record) == 1 ||
+				sscanf(line, "elapsed %" SCNu64, &cp->elapsed_ns) == 1)
+		{
+			continue;
+		}
+		else if (sscanf(line, "input %zu %jd", &cp->file, &offset) == 2)
+		{
+			cp->offset = (off_t)offset;
+		}
+		else if (sscanf(line, "output %jd", &output) == 1)
+		{
+			cp->output = (off_t)output;
+		}
+		else if (strncmp(line, "counts ", LEN("counts ")) == 0)
+		{
+			p = line + LEN("counts");
+			for (i = 0; i < ST_NUM && ok == 0; i++)
+			{
+				if (sscanf(p, " %zu%n", &cp->counts[i], &n) != 1)
+					ok = -1;
+				p += n;
+			}
+		}
+		else if (sscanf(line, "hist %" SCNu64 " %" SCNu64 " %" SCNu64
+				" %" SCNu64, &cp->hist.count, &cp->hist.sum, &cp->hist.min,
+				&cp->hist.max) == 4)
+		{
+			continue;
+		}
+		else if (sscanf(line, "bucket %zu %" SCNu64, &bucket, &value) == 2)
+		{
+			if (bucket < HIST_BUCKETS)
+				cp->hist.buckets[bucket] = value;
+			else
+				ok = -1;
+		}
+		else if (sscanf(line, "slow %" SCNu64 " %zu %81s", &value, &i,
+				puzzle) == 3 && cp->slowest.num < SLOWEST_MAX)
+		{
+			e = &cp->slowest.entries[cp->slowest.num++];
+			e->value = value;
+			e->index = i;
+			if (grid_parse(e->puzzle, puzzle, strlen(puzzle)) < 0)
+				ok = -1;
+		}
+		else if (strcmp(line, "end\n") == 0 && cp->inputs &&
+				num_inputs == cp->num_inputs)
+		{
+			ok = 1;
+		}
+		else
+		{
+			ok = -1;
+		}
+	}
+	fclose(fp);
+	if (ok != 1)
+	{
+		fprintf(stderr, "%s: Error: Invalid checkpoint!\n", path);
+		checkpoint_free(cp);
+		return -1;
+	}
+	return 0;
+}
+
+int checkpoint_set_inputs(Checkpoint *cp, char *files[], size_t num_files)
+{
+	Checkpoint_Input *f;
+	struct stat st;
+	size_t i, num = num_files ? num_files : 1;
+	int ret;
+
+	checkpoint_free(cp);
+	cp->inputs = calloc(num, sizeof(*f));
+	if (!cp->inputs)
+	{
+		perror("calloc");
+		return -1;
+	}
+	cp->num_inputs = num;
+	for (i = 0; i < num; i++)
+	{
+		f = &cp->inputs[i];
+		f->path = strdup(num_files ? files[i] : "-");
+		if (!f->path)
+		{
+			perror("strdup");
+			return -1;
+		}
+		/* The path ends the line of the file */
+		if (strchr(f->path, '\n'))
+		{
+			errno = EINVAL;
+			perror(f->path);
+			return -1;
+		}
+		ret = num_files ? stat(f->path, &st) : fstat(STDIN_FILENO, &st);
+		/* A missing file is reported when it is read */
+		f->size = (ret == 0 && S_ISREG(st.st_mode)) ? st.st_size : -1;
+		f->mtime = (ret == 0) ? (int64_t)st.st_mtime : 0;
+	}
+	return 0;
+}
+
+bool checkpoint_same_inputs(const Checkpoint *a, const Checkpoint *b)
+{
+	size_t i;
+
+	if (a->num_inputs != b->num_inputs)
+	{
+		return false;
+	}
+	for (i = 0; i < a->num_inputs; i++)
+	{
+		if (strcmp(a->inputs[i].path, b->inputs[i].path) != 0 ||
+				a->inputs[i].size != b->inputs[i].size ||
+				a->inputs[i].mtime != b->inputs[i].mtime)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+void checkpoint_free(Checkpoint *cp)
+{
+	size_t i;
+
+	for (i = 0; i < cp->num_inputs; i++)
+	{
+		free(cp->inputs[i].path);
+	}
+	free(cp->inputs);
+	cp->inputs = NULL;
+	cp->num_inputs = 0;
+}
@@ -0,0 +1,81 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright (c) 2023 Rainer Holzner <rholzner@web.de> */
+
+#ifndef _CHECKPOINT_H_
+#define _CHECKPOINT_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <limits.h>
+#include <sys/types.h>
+#include "batch.h"
+#include "hist.h"
+
+/* An input file as it was when the run started. A run can only be
+ * continued with the same files, unchanged.
+ */
+typedef struct _checkpoint_input
+{
+	/* "-" for STDIN */
+	char *path;
+	/* -1 if it is not a regular file */
+	off_t size;
+	int64_t mtime;
+} Checkpoint_Input;
+
+/* Progress of a batch run, enough to continue it in a new process */
+typedef struct _checkpoint
+{
+	Batch_Mode mode;
+	Batch_Format format;
+	size_t shard, num_shards;
+	/* Options that change the results */
+	int count;
+	size_t budget;
+	/* Path of the store the puzzles are looked up in, "" if none */
+	char store[PATH_MAX];
+	/* The input files, or STDIN */
+	size_t num_inputs;
+	Checkpoint_Input *inputs;
+	/* Input position: file number and byte offset within that file */
+	size_t file;
+	off_t offset;
+	/* Index of the next record */
+	size_t record;
+	/* Number of bytes written to the output */
+	off_t output;
+	/* Run time of all previous runs */
+	uint64_t elapsed_ns;
+	size_t counts[ST_NUM];
+	Hist hist;
+	Slowest slowest;
+} Checkpoint;
+
+/* Writes the checkpoint to a temporary file and renames it to path,
+ * so that path always holds either the old or the new checkpoint.
+ * Returns 0 on success, else -1.
+ */
+int checkpoint_write(const char *path, const Checkpoint *cp);
+
+/* Allocates the inputs, free them with checkpoint_free().
+ * Returns 0 on success, 1 if there is no checkpoint at path,
+ * else -1.
+ */
+int checkpoint_read(const char *path, Checkpoint *cp);
+
+/* Sets the inputs to the files as they are now, or to STDIN if
+ * num_files is 0.
+ * Returns 0 on success, else -1.
+ */
+int checkpoint_set_inputs(Checkpoint *cp, char *files[], size_t num_files);
+
+/* Returns true if both checkpoints have the same input files, with the
+ * same size and modification time
+ */
+bool checkpoint_same_inputs(const Checkpoint *a, const Checkpoint *b);
+
+/* Frees the inputs */
+void checkpoint_free(Checkpoint *cp);
+
+#endif
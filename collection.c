@@ -0,0 +1,280 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright (c) 2023 Rainer Holzner <rholzner@web.de> */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "collection.h"
+
+#define INDEX_MAGIC "sdkidx1"
+#define TEMP_SUFFIX ".tmp"
+
+/* The index file is this header followed by num_lines offsets, in the
+ * byte order of the machine that wrote it. The magic tells others apart.
+ */
+typedef struct _index_header
+{
+	char magic[8];
+	uint64_t size;
+	int64_t mtime;
+	uint64_t num_lines;
+} Index_Header;
+
+/* The index of "dir/file" is "dir/.file.idx", hidden like the index of
+ * the library, so that listings of the directory skip it.
+ */
+static int index_path(const Collection *c, char *buf, size_t size,
+		const char *suffix)
+{
+	const char *name = strrchr(c->path, '/');
+	int dir_len;
+
+	name = name ? name + 1 : c->path;
+	dir_len = (int)(name - c->path);
+	if ((size_t)snprintf(buf, size, "%.*s.%s" COLLECTION_INDEX_SUFFIX "%s",
+				dir_len, c->path, name, suffix) >= size)
+	{
+		errno = ENAMETOOLONG;
+		return -1;
+	}
+	return 0;
+}
+
+/* Offsets must start lines of the file, one after another */
+static bool offsets_valid(const uint64_t *offsets, size_t num,
+		size_t size)
+{
+	size_t i;
+
+	for (i = 0; i < num; i++)
+	{
+		if (offsets[i] >= size || (i > 0 && offsets[i] <= offsets[i-1]))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+/* Uses the index file if it belongs to the current file.
+ * Returns 0 on success, else -1.
+ */
+static int load_index(Collection *c)
+{
+	char path[sizeof(c->path) + 16];
+	const Index_Header *h;
+	struct stat st;
+	void *map;
+	int fd, ret = -1;
+
+	if (index_path(c, path, sizeof(path), "") != 0)
+	{
+		return -1;
+	}
+	fd = open(path, O_RDONLY);
+	if (fd == -1)
+	{
+		return -1;
+	}
+	if (fstat(fd, &st) == 0 && (size_t)st.st_size >= sizeof(*h))
+	{
+		map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (map != MAP_FAILED)
+		{
+			h = map;
+			if (memcmp(h->magic, INDEX_MAGIC, sizeof(h->magic)) == 0 &&
+				h->size == c->size && h->mtime == c->mtime &&
+				h->num_lines == ((size_t)st.st_size - sizeof(*h)) /
+					sizeof(uint64_t) &&
+				offsets_valid((const uint64_t *)(h + 1), h->num_lines,
+					c->size))
+			{
+				c->index_map = map;
+				c->index_size = st.st_size;
+				c->offsets = (const uint64_t *)(h + 1);
+				c->num_lines = h->num_lines;
+				c->scan = c->size;
+				c->complete = true;
+				ret = 0;
+			}
+			else
+			{
+				munmap(map, st.st_size);
+			}
+		}
+	}
+	close(fd);
+	return ret;
+}
+
+/* The index is a cache: failing to write it, e.g. in a read-only
+ * directory, is not an error.
+ */
+static void save_index(const Collection *c)
+{
+	char path[sizeof(c->path) + 16], temp[sizeof(path)];
+	Index_Header h;
+	FILE *fp;
+	int ok;
+
+	if (index_path(c, path, sizeof(path), "") != 0 ||
+		index_path(c, temp, sizeof(temp), TEMP_SUFFIX) != 0)
+	{
+		return;
+	}
+	fp = fopen(temp, "wb");
+	if (fp == NULL)
+	{
+		return;
+	}
+	memset(&h, 0, sizeof(h));
+	memcpy(h.magic, INDEX_MAGIC, sizeof(h.magic));
+	h.size = c->size;
+	h.mtime = c->mtime;
+	h.num_lines = c->num_lines;
+	ok = fwrite(&h, sizeof(h), 1, fp) == 1 &&
+		fwrite(c->offsets, sizeof(uint64_t), c->num_lines, fp) ==
+			c->num_lines;
+	ok = (fclose(fp) == 0) && ok;
+	if (!ok || rename(temp, path) == -1)
+	{
+		unlink(temp);
+	}
+}
+
+static int append(Collection *c, size_t offset)
+{
+	uint64_t *p;
+	size_t capacity;
+
+	if (c->num_lines == c->capacity)
+	{
+		capacity = c->capacity ? c->capacity * 2 : 1024;
+		p = realloc(c->built, capacity * sizeof(*p));
+		if (p == NULL)
+		{
+			return -1;
+		}
+		c->built = p;
+		c->capacity = capacity;
+		c->offsets = p;
+	}
+	c->built[c->num_lines++] = offset;
+	return 0;
+}
+
+/* Finds the next line.
+ * Returns 0 on success, -1 at the end of the file or if out of memory.
+ */
+static int scan_line(Collection *c)
+{
+	const char *nl;
+
+	if (c->scan >= c->size)
+	{
+		c->complete = true;
+		return -1;
+	}
+	if (append(c, c->scan) != 0)
+	{
+		return -1;
+	}
+	nl = memchr(c->data + c->scan, '\n', c->size - c->scan);
+	c->scan = nl ? (size_t)(nl - c->data) + 1 : c->size;
+	if (c->scan >= c->size)
+	{
+		c->complete = true;
+		save_index(c);
+	}
+	return 0;
+}
+
+int collection_open(Collection *c, const char *path)
+{
+	struct stat st;
+	void *map = NULL;
+	int fd;
+
+	memset(c, 0, sizeof(*c));
+	if (strlen(path) >= sizeof(c->path))
+	{
+		errno = ENAMETOOLONG;
+		return -1;
+	}
+	strcpy(c->path, path);
+	fd = open(path, O_RDONLY);
+	if (fd == -1)
+	{
+		return -1;
+	}
+	if (fstat(fd, &st) == -1)
+	{
+		close(fd);
+		return -1;
+	}
+	if (st.st_size > 0)
+	{
+		map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (map == MAP_FAILED)
+		{
+			close(fd);
+			return -1;
+		}
+	}
+	/* The mapping stays valid without the descriptor */
+	close(fd);
+	c->data = map;
+	c->size = st.st_size;
+	c->mtime = (int64_t)st.st_mtime;
+	load_index(c);
+	return 0;
+}
+
+void collection_close(Collection *c)
+{
+	if (c->data)
+	{
+		munmap((void *)c->data, c->size);
+	}
+	if (c->index_map)
+	{
+		munmap(c->index_map, c->index_size);
+	}
+	free(c->built);
+	memset(c, 0, sizeof(*c));
+}
+
+long collection_count(const Collection *c)
+{
+	return c->complete ? (long)c->num_lines : -1;
+}
+
+int collection_get(Collection *c, size_t n, const char **line, size_t *len)
+{
+	size_t start, end;
+	const char *nl;
+
+	while (n >= c->num_lines)
+	{
+		if (scan_line(c) != 0)
+		{
+			return -1;
+		}
+	}
+	start = c->offsets[n];
+	nl = memchr(c->data + start, '\n', c->size - start);
+	end = nl ? (size_t)(nl - c->data) : c->size;
+	if (end > start && c->data[end-1] == '\r')
+	{
+		end--;
+	}
+	*line = c->data + start;
+	*len = end - start;
+	return 0;
+}
@@ -0,0 +1,58 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright (c) 2023 Rainer Holzner <rholzner@web.de> */
+
+#ifndef _COLLECTION_H_
+#define _COLLECTION_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <limits.h>
+
+/* Suffix of the side index file */
+#define COLLECTION_INDEX_SUFFIX ".idx"
+
+/* A file with one puzzle per line, mapped into memory.
+ * Line offsets are found on demand: only the part of the file up to the
+ * line asked for is read. Once the end has been reached, the offsets are
+ * saved to a hidden side index file ".<file>.idx" in the same directory,
+ * so that the next open knows all lines right away. An index that does
+ * not fit the file is rebuilt.
+ */
+typedef struct _collection
+{
+	char path[PATH_MAX];
+	const char *data;
+	size_t size;
+	/* Offsets of the lines found so far. Points into the mapped index
+	 * file or to the array built while scanning.
+	 */
+	const uint64_t *offsets;
+	size_t num_lines;
+	/* Where scanning continues */
+	size_t scan;
+	/* All lines are known */
+	bool complete;
+	/* The built array, NULL if the index file is used */
+	uint64_t *built;
+	size_t capacity;
+	/* Mapping of the index file */
+	void *index_map;
+	size_t index_size;
+	/* Modification time of the file, to validate the index */
+	int64_t mtime;
+} Collection;
+
+/* Returns 0 on success, else -1 with errno set */
+int collection_open(Collection *c, const char *path);
+void collection_close(Collection *c);
+
+/* Returns the number of lines if all are known, else -1 */
+long collection_count(const Collection *c);
+
+/* Finds line n (from 0), without its line end.
+ * Returns 0 on success, -1 if the file has fewer lines.
+ */
+int collection_get(Collection *c, size_t n, const char **line, size_t *len);
+
+#endif
@@ -4,6 +4,13 @@ BIN_NAME_SOLVER = sudoku-solver
 MAN_NAME_SOLVER = $(BIN_NAME_SOLVER).6
 BIN_NAME_EDITOR = sudoku-editor
 MAN_NAME_EDITOR = $(BIN_NAME_EDITOR).6
+BIN_NAME_MERGE = sudoku-merge
+MAN_NAME_MERGE = $(BIN_NAME_MERGE).6
+BIN_NAME_STORE = sudoku-store
+MAN_NAME_STORE = $(BIN_NAME_STORE).6
+# Not installed: make verify, make fuzz
+BIN_NAME_VERIFY = sudoku-verify
+BIN_NAME_FUZZ = sudoku-fuzz
 INSTALL_PATH = /usr/local/bin
 MANPAGE_PATH = /usr/local/share/man/man6
 
@@ -13,12 +20,30 @@ WORKDIR = .local/share/$(BIN_NAME_EDITOR)
 # For generating the manpage
 TITLE_SOLVER = SUDOKU-SOLVER
 TITLE_EDITOR = SUDOKU-EDITOR
+TITLE_MERGE = SUDOKU-MERGE
+TITLE_STORE = SUDOKU-STORE
 
 CC = gcc
 # debug
 #CFLAGS = -ggdb -O0 -Wall -Wextra -Wpedantic
 CFLAGS = -O2
-CFLAGS_SOLVER = $(CFLAGS)
-CFLAGS_EDITOR = $(CFLAGS)
+CFLAGS_COMMON = $(CFLAGS)
+CFLAGS_SOLVER = $(CFLAGS) -pthread
+CFLAGS_EDITOR = $(CFLAGS) -pthread
+CFLAGS_MERGE = $(CFLAGS)
+CFLAGS_STORE = $(CFLAGS)
+CFLAGS_VERIFY = $(CFLAGS)
 LDFLAGS =
+LDFLAGS_SOLVER = $(LDFLAGS) -pthread
+LDFLAGS_EDITOR = $(LDFLAGS) -pthread
+LDFLAGS_MERGE = $(LDFLAGS)
+LDFLAGS_STORE = $(LDFLAGS)
+LDFLAGS_VERIFY = $(LDFLAGS)
+
+# make verify: random puzzles, and files of puzzles to check as well
+VERIFY_NUM = 2000
+VERIFY_CORPUS =
+# make fuzz needs a compiler with libFuzzer
+FUZZ_CC = clang
+FUZZ_CFLAGS = -g -O1 -fsanitize=fuzzer,address,undefined
 
@@ -0,0 +1,235 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright (c) 2023 Rainer Holzner <rholzner@web.de> */
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <string.h>
+#include "grid.h"
+#include "search.h"
+#include "engine.h"
+#include "crosscheck.h"
+
+/* Solutions counted at most */
+#define MAX_COUNT 2
+
+typedef struct _enum_state
+{
+	int count;
+	Grid first;
+} Enum_State;
+
+static int fail(Crosscheck *c, const char *fmt, ...)
+{
+	va_list ap;
+
+	va_start(ap, fmt);
+	vsnprintf(c->why, sizeof(c->why), fmt, ap);
+	va_end(ap);
+	return 1;
+}
+
+/* The reference: every pair of cells of every unit, nothing clever */
+static bool valid(const Grid g)
+{
+	unsigned char units[GRID_MAX_UNITS][9];
+	unsigned n, u, i, j;
+
+	n = grid_units(units);
+	for (u = 0; u < n; u++)
+	{
+		for (i = 0; i < 9; i++)
+		{
+			for (j = i + 1; j < 9; j++)
+			{
+				if (g[units[u][i]] && g[units[u][i]] == g[units[u][j]])
+				{
+					return false;
+				}
+			}
+		}
+	}
+	return true;
+}
+
+static int blanks(const Grid g)
+{
+	int i, n = 0;
+
+	for (i = 0; i < GRID_CELLS; i++)
+	{
+		n += (g[i] == 0);
+	}
+	return n;
+}
+
+/* A solution must be complete, valid and keep the clues */
+static bool solves(const Grid solution, const Grid g)
+{
+	unsigned i;
+
+	for (i = 0; i < GRID_CELLS; i++)
+	{
+		if (solution[i] == 0 || (g[i] && g[i] != solution[i]))
+		{
+			return false;
+		}
+	}
+	return valid(solution);
+}
+
+/* Counts the solutions of the search, up to MAX_COUNT.
+ * Returns -1 if the budget ran out.
+ */
+static int search_count(Crosscheck *c, const Grid g, Grid first)
+{
+	Search *s = &c->search;
+	int n = 0, ret, cell_no;
+
+	search_init(s, g);
+	for (;;)
+	{
+		ret = search_run(s, (s->iterations < c->budget) ?
+				c->budget - s->iterations : 0, NULL);
+		if (ret == 1)
+		{
+			return -1;
+		}
+		if (ret < 0)
+		{
+			return n;
+		}
+		if (n++ == 0)
+		{
+			search_get(s, first);
+		}
+		if (n == MAX_COUNT)
+		{
+			return n;
+		}
+		/* The next solution: go on with the last cell the search set */
+		for (cell_no = GRID_CELLS - 1;
+			cell_no >= 0 && s->cells[cell_no].ct == CT_FIXED; cell_no--)
+		{
+		}
+		if (cell_no < 0)
+		{
+			return n;
+		}
+		s->cell_no = cell_no;
+	}
+}
+
+static int enum_found(const Grid solution, void *arg)
+{
+	Enum_State *es = arg;
+
+	if (es->count++ == 0)
+	{
+		memcpy(es->first, solution, sizeof(es->first));
+	}
+	return es->count == MAX_COUNT;
+}
+
+int crosscheck_puzzle(Crosscheck *c, const Grid g)
+{
+	Enum_State es;
+	Grid search_first, engine_first;
+	bool ref;
+	int check, n_search, n_engine, n_parts, num_parts, i, n;
+
+	c->why[0] = '\0';
+	ref = valid(g);
+	check = grid_check(g);
+	if ((check >= 0) != ref)
+	{
+		return fail(c, "grid_check() says %s", ref ? "invalid" : "valid");
+	}
+	if (ref && check != blanks(g))
+	{
+		return fail(c, "grid_check() counts %d blanks, not %d", check,
+				blanks(g));
+	}
+	search_init(&c->search, g);
+	if (search_check_all(&c->search) != ref)
+	{
+		return fail(c, "search_check_all() says %s",
+				ref ? "invalid" : "valid");
+	}
+	if (!ref)
+	{
+		if (engine_init(&c->engine, g) == 0)
+		{
+			return fail(c, "engine_init() takes invalid clues");
+		}
+		return 0;
+	}
+
+	n_search = search_count(c, g, search_first);
+	if (n_search < 0)
+	{
+		return -1;
+	}
+	engine_init(&c->engine, g);
+	n_engine = engine_count(&c->engine, MAX_COUNT);
+	memcpy(engine_first, c->engine.solution, sizeof(engine_first));
+	if (n_engine != n_search)
+	{
+		return fail(c, "search finds %d solutions, engine_count() %d",
+				n_search, n_engine);
+	}
+
+	es.count = 0;
+	engine_init(&c->engine, g);
+	engine_enumerate(&c->engine, enum_found, &es);
+	if (es.count != n_engine)
+	{
+		return fail(c, "engine_enumerate() finds %d solutions, "
+				"engine_count() %d", es.count, n_engine);
+	}
+
+	engine_init(&c->engine, g);
+	num_parts = engine_split(&c->engine, c->parts, CROSSCHECK_PARTS);
+	n_parts = 0;
+	for (i = 0; i < num_parts && n_parts < MAX_COUNT; i++)
+	{
+		c->engine.state = c->parts[i];
+		n = engine_count(&c->engine, MAX_COUNT - n_parts);
+		n_parts += n;
+		if (n > 0 && !solves(c->engine.solution, g))
+		{
+			return fail(c, "part %d of engine_split() has a wrong "
+					"solution", i);
+		}
+	}
+	if (n_parts != n_engine)
+	{
+		return fail(c, "the parts of engine_split() have %d solutions, "
+				"engine_count() %d", n_parts, n_engine);
+	}
+
+	if (n_engine == 0)
+	{
+		return 0;
+	}
+	if (!solves(search_first, g))
+	{
+		return fail(c, "the solution of the search is wrong");
+	}
+	if (!solves(engine_first, g))
+	{
+		return fail(c, "the solution of engine_count() is wrong");
+	}
+	if (memcmp(es.first, engine_first, sizeof(engine_first)) != 0)
+	{
+		return fail(c, "engine_enumerate() and engine_count() start "
+				"with different solutions");
+	}
+	if (n_engine == 1 && memcmp(search_first, engine_first,
+			sizeof(engine_first)) != 0)
+	{
+		return fail(c, "the search and the engine find different "
+				"unique solutions");
+	}
+	return 0;
+}
@@ -0,0 +1,39 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright (c) 2023 Rainer Holzner <rholzner@web.de> */
+
+#ifndef _CROSSCHECK_H_
+#define _CROSSCHECK_H_
+
+#include <stddef.h>
+#include "grid.h"
+#include "search.h"
+#include "engine.h"
+
+/* Parts engine_split() is checked with */
+#define CROSSCHECK_PARTS 16
+
+/* Runs all engines on a puzzle and compares their results: the
+ * validity verdicts of grid_check(), the search and the engine against a
+ * plain check of every unit, the number of solutions (up to 2) of the
+ * search, engine_count(), engine_enumerate() and the parts of
+ * engine_split(), and the solutions themselves.
+ * search_setup() and engine_setup() must have been called.
+ * Each thread must use its own instance.
+ */
+typedef struct _crosscheck
+{
+	Search search;
+	Engine engine;
+	Engine_State parts[CROSSCHECK_PARTS];
+	/* Iterations of the search at most, it is slow on some puzzles */
+	size_t budget;
+	/* What did not agree */
+	char why[256];
+} Crosscheck;
+
+/* Returns 0 if all engines agree on g, 1 if not (see why), or -1 if the
+ * search ran out of budget before it was clear.
+ */
+int crosscheck_puzzle(Crosscheck *c, const Grid g);
+
+#endif
@@ -10,6 +10,7 @@
 #include <time.h>
 #include <limits.h>
 #include <errno.h>
+#include <poll.h>
 //#include <assert.h>
 #include <sys/stat.h>
 #include <sys/types.h>
@@ -18,6 +19,17 @@
 #include "tui.h"
 #include "config.h"
 #include "util.h"
+#include "grid.h"
+#include "search.h"
+#include "engine.h"
+#include "bg.h"
+#include "track.h"
+#include "hint.h"
+#include "undo.h"
+#include "collection.h"
+#include "library.h"
+#include "bulk.h"
+#include "trace.h"
 
 #define NUM_ELEMENTS(x) (sizeof(x)/sizeof(x[0]))
 #define LEN(s) (sizeof(s)-1)
@@ -25,12 +37,24 @@
 #define NOT_EMPTY(s) (s && (s[0] != '\0'))
 #define UNUSED_PARAM(p) (void)(p)
 
-#define TEMPFILE_SUFFIX "-edit.tmp"
-#define TEMPFILE "/tmp/sudoku-XXXXXX"TEMPFILE_SUFFIX
-#define REDIRECT_INPUT " < "
-#define REDIRECT_STDERR_TO_STDOUT " 2>&1"
-#define SOLVE_CMD_TEMPLATE \
-	SOLVER REDIRECT_INPUT TEMPFILE REDIRECT_STDERR_TO_STDOUT
+/* Number of search iterations between two checks for cancellation */
+#define SOLVE_SLICE 4096
+/* Milliseconds between two status updates while solving */
+#define SOLVE_STATUS_INTERVAL 100
+
+/* Width of the progress bar of the bulk solve */
+#define BULK_BAR_LEN 30
+
+/* Frames per second a replay starts with, and the most it goes to */
+#define REPLAY_SPEED 20
+#define REPLAY_SPEED_MAX (1u << 20)
+/* Milliseconds between two screen updates of a replay */
+#define REPLAY_TICK 40
+
+/* Rows of the library browser */
+#define BROWSER_TOP 2
+#define BROWSER_ROWS 20
+#define BROWSER_PREVIEW_X 58
 
 /* Origin coordinates of the Sudoku grid on screen */
 #define FRAME_POS_X 0
@@ -46,11 +70,46 @@ static char wdir[PATH_MAX];
 /* The Sudoku map */
 static int cells[9][9];
 static bool fixed[9][9];
+/* Values per row, column and box of the map, for finding conflicts */
+static Track track;
+/* Show the candidates of the selected cell */
+static bool show_marks;
+/* Candidates removed by hints, until the next edit */
+static unsigned short removed[9][9];
+/* The open file if it holds more than one puzzle, one per line */
+static Collection collection;
+static bool in_collection;
+/* Line of the collection shown */
+static size_t entry;
+/* Edits that can be undone and redone */
+static Undo undo;
+/* The last hint, highlighted until the next key */
+static Hint hint;
+static bool show_hint;
 /* Indicates which cell is currently selected */
 static size_t cell_x, cell_y;
 /* Status bar */
 static char status_text[128];
 static Color status_color;
+/* The background solver */
+static Bg_Job solver;
+/* Keeps the last solution, so that edits are solved from there */
+static Search_Context solver_context;
+static int solver_result;
+static struct timespec solver_start, solver_end;
+/* The background check for the number of solutions of the clues */
+static Bg_Job checker;
+static Engine checker_engine;
+static int checker_result;
+/* The clues changed since the last check was started */
+static bool clues_changed = true;
+/* 0, 1, 2 for two or more, or -1 while unknown */
+static int num_solutions = -1;
+/* Solving all puzzles of the working directory in the background */
+static Bg_Job bulk_job;
+static Bulk bulk;
+static int bulk_result;
+static struct timespec bulk_start, bulk_end;
 
 /* Translate cell coordinates into text buffer coordinats */
 static void translate(size_t cl_x, size_t cl_y, size_t *buf_x, size_t *buf_y)
@@ -74,15 +133,27 @@ static void translate(size_t cl_x, size_t cl_y, size_t *buf_x, size_t *buf_y)
 	*buf_y=y;
 }
 
-static void place_cursor(void)
+/* Values that fit into a cell, bit v for value v */
+static unsigned candidates(size_t x, size_t y)
 {
-	size_t x, y;
+	return track_candidates(&track, x, y) & ~removed[y][x];
+}
 
-	translate(cell_x, cell_y, &x, &y);
-	/* Add offsets */
-	x+=FRAME_POS_X;
-	y+=FRAME_POS_Y;
-	set_cursor_pos(x+1, y+1);
+/* Background of a cell that belongs to the hint */
+static Color hint_color(size_t x, size_t y)
+{
+	unsigned i, cell_no = y*9 + x;
+
+	if (!show_hint)
+		return SYS_DEFAULT;
+	if ((int)cell_no == hint.cell_no || hint.eliminate[cell_no] != 0)
+		return MAGENTA;
+	for (i = 0; i < hint.num_cause; i++)
+	{
+		if (hint.cause[i] == cell_no)
+			return CYAN;
+	}
+	return SYS_DEFAULT;
 }
 
 static void update_grid(void)
@@ -99,7 +170,9 @@ static void update_grid(void)
 			tc.c = (val > 0 && val <= 9) ? ('0' + val) : ' ';
 			if (val > 0 && val <= 9)
 			{
-				if (fixed[y0][x0])
+				if (track_conflict(&track, x0, y0, val))
+					tc.fg = RED;
+				else if (fixed[y0][x0])
 					tc.fg = YELLOW;
 				else
 					tc.fg = SYS_DEFAULT;
@@ -108,24 +181,111 @@ static void update_grid(void)
 			{
 				tc.fg = SYS_DEFAULT;
 			}
+			tc.bg = hint_color(x0, y0);
 			translate(x0, y0, &x, &y);
 			tui_frame_set(x, y, &tc);
 		}
 	}
 }
 
+/* Pencil marks of the selected cell */
+static void draw_marks(size_t y)
+{
+	unsigned mask;
+	int val;
+	size_t x;
+	char digit[3] = " 0";
+
+	x = tui_text(0, y, "Candidates:", SYS_DEFAULT, SYS_DEFAULT, NORMAL);
+	if (cells[cell_y][cell_x] != 0)
+	{
+		return;
+	}
+	mask = candidates(cell_x, cell_y);
+	for (val = 1; val <= 9; val++)
+	{
+		if (mask & (1u << val))
+		{
+			digit[1] = '0' + val;
+			x = tui_text(x, y, digit, SYS_DEFAULT, SYS_DEFAULT, NORMAL);
+		}
+	}
+	if (mask == 0)
+	{
+		tui_text(x, y, " none", RED, SYS_DEFAULT, NORMAL);
+	}
+}
+
+/* Result of the background check */
+static void draw_solutions(size_t y)
+{
+	size_t x;
+
+	x = tui_text(0, y, "Solutions: ", SYS_DEFAULT, SYS_DEFAULT, NORMAL);
+	switch (num_solutions)
+	{
+	case 0:
+		tui_text(x, y, "none", RED, SYS_DEFAULT, NORMAL);
+		break;
+	case 1:
+		tui_text(x, y, "1 (unique)", GREEN, SYS_DEFAULT, NORMAL);
+		break;
+	case 2:
+		tui_text(x, y, "many", YELLOW, SYS_DEFAULT, NORMAL);
+		break;
+	default:
+		tui_text(x, y, "..", SYS_DEFAULT, SYS_DEFAULT, NORMAL);
+		break;
+	}
+}
+
+/* Name of the collection and the line shown */
+static void draw_position(size_t x)
+{
+	const char *name = strrchr(collection.path, '/');
+	char pos[64];
+	long count = collection_count(&collection);
+
+	name = name ? name + 1 : collection.path;
+	if (count >= 0)
+		snprintf(pos, sizeof(pos), " %zu/%ld", entry + 1, count);
+	else
+		snprintf(pos, sizeof(pos), " %zu/?", entry + 1);
+	x = tui_text(x, 0, name, CYAN, SYS_DEFAULT, NORMAL);
+	tui_text(x, 0, pos, CYAN, SYS_DEFAULT, NORMAL);
+}
+
+/* Draws into the screen buffer and sends the changes to the terminal */
 static void draw_all(void)
 {
-	tui_clear_screen();
-	puts("Sudoku Editor v" VERSION);
+	size_t x, y;
+
+	tui_begin();
+	x = tui_text(0, 0, "Sudoku Editor v" VERSION,
+			SYS_DEFAULT, SYS_DEFAULT, NORMAL);
+	if (in_collection)
+	{
+		draw_position(x + 2);
+	}
 	tui_frame_draw();
+	y = FRAME_POS_Y + FRAME_SIZE_Y;
+	draw_solutions(y);
+	y++;
 	if (status_text[0] != '\0')
 	{
-		putchar('\n');
-		tui_print(status_text, status_color, SYS_DEFAULT, NORMAL);
+		tui_text(0, y, status_text, status_color, SYS_DEFAULT, NORMAL);
 	}
-	puts("\n\nPress '?' for instructions.");
-	place_cursor();
+	y += 2;
+	if (show_marks)
+	{
+		draw_marks(y);
+		y += 2;
+	}
+	tui_text(0, y, "Press '?' for instructions.",
+			SYS_DEFAULT, SYS_DEFAULT, NORMAL);
+
+	translate(cell_x, cell_y, &x, &y);
+	tui_flush(x + FRAME_POS_X, y + FRAME_POS_Y);
 }
 
 /* Prompt the user for input
@@ -160,6 +320,35 @@ static char *prompt(const char *message)
 	return ret;
 }
 
+/* Changes one cell and keeps track of its value */
+static void put_cell(size_t x, size_t y, int val, bool fix)
+{
+	track_remove(&track, x, y, cells[y][x]);
+	/* Eliminations of hints may no longer hold */
+	memset(removed, 0, sizeof(removed));
+	if (fix || fixed[y][x])
+	{
+		clues_changed = true;
+	}
+	cells[y][x] = val;
+	fixed[y][x] = fix;
+	track_add(&track, x, y, val);
+}
+
+/* Like put_cell(), and records the change for undo */
+static void set_cell(size_t x, size_t y, int val, bool fix)
+{
+	undo_add(&undo, y*9 + x, UNDO_CELL(cells[y][x], fixed[y][x]),
+			UNDO_CELL(val, fix));
+	put_cell(x, y, val, fix);
+}
+
+static void undo_apply(unsigned cell_no, unsigned char cell, void *arg)
+{
+	UNUSED_PARAM(arg);
+	put_cell(cell_no%9, cell_no/9, UNDO_VALUE(cell), UNDO_FIXED(cell));
+}
+
 static int read_puzzle(const char *path)
 {
 	FILE *fp;
@@ -195,8 +384,11 @@ static int read_puzzle(const char *path)
 		perror("fopen");
 	if (i == 81)
 	{
-		memcpy(cells, tmp_cells, sizeof(cells));
-		memcpy(fixed, tmp_fixed, sizeof(fixed));
+		/* One undo entry for the whole puzzle */
+		for (i = 0; i < GRID_CELLS; i++)
+		{
+			set_cell(i%9, i/9, tmp_cells[i/9][i%9], tmp_fixed[i/9][i%9]);
+		}
 		return 0;
 	}
 	return -1;
@@ -244,107 +436,309 @@ static int write_puzzle(const char *path)
 	return ret;
 }
 
-/* Hint: This is not the solving algorithm rather the code
- * that invokes it.
- */
-static int solve(struct timespec *tp, size_t *iterations)
+static double elapsed(const struct timespec *tp0,
+		const struct timespec *tp1)
 {
-	char template[] = TEMPFILE;
-	char cmd[sizeof(SOLVE_CMD_TEMPLATE)];
-	int ret, fd;
-	FILE *fp;
-	int c;
-	size_t i, x, y;
-	struct timespec tp0, tp1;
+	return (double)(tp1->tv_sec - tp0->tv_sec) +
+		(double)(tp1->tv_nsec - tp0->tv_nsec)/1e9;
+}
 
-	i = 0;
-	ret = -1;
-	fd = mkstemps(template, LEN(TEMPFILE_SUFFIX));
-	if (fd >= 0)
+/* Runs in the background thread */
+static void solve_func(Bg_Job *job)
+{
+	Search_Context *c = job->arg;
+	int ret;
+
+	do
 	{
-		fp = fdopen(fd, "w");
-		if (fp)
-		{
-			ret = fwrite_puzzle(fp);
-			fclose(fp);
-		}
-		else
-		{
-			perror("fdopen");
-			close(fd);
-		}
+		ret = search_run(&c->search, SOLVE_SLICE, NULL);
+		bg_progress(job, c->search.iterations);
 	}
-	if (ret == 0)
+	while (ret == 1 && !bg_cancelled(job));
+	search_context_end(c, ret);
+	solver_result = ret;
+	clock_gettime(CLOCK_MONOTONIC, &solver_end);
+}
+
+/* Shows the result of the solver */
+static void solve_show(void)
+{
+	Grid g;
+	size_t i;
+
+	if (solver_result != 0)
 	{
-		if (!make_string(cmd, sizeof(cmd),
-				SOLVER REDIRECT_INPUT "%s" REDIRECT_STDERR_TO_STDOUT,
-				template))
+		strncpy(status_text, "Cannot solve this Sudoku!", LEN(status_text));
+		status_color = RED;
+		return;
+	}
+	search_get(&solver_context.search, g);
+	for (i = 0; i < GRID_CELLS; i++)
+	{
+		if (!fixed[i/9][i%9])
 		{
-			ret = -1;
+			set_cell(i%9, i/9, g[i], false);
 		}
 	}
-	if (ret == 0)
+	if (!make_string(status_text, sizeof(status_text),
+			"Solved!\nIterations=%zu, Time=%fs",
+			solver_context.search.iterations,
+			elapsed(&solver_start, &solver_end)))
+	{
+		//TODO: die()
+	}
+	status_color = GREEN;
+}
+
+static void solve_start(void)
+{
+	Grid g;
+	size_t i;
+
+	for (i = 0; i < GRID_CELLS; i++)
+	{
+		g[i] = fixed[i/9][i%9] ? (unsigned char)cells[i/9][i%9] : 0;
+	}
+	clock_gettime(CLOCK_MONOTONIC, &solver_start);
+	solver_result = search_context_begin(&solver_context, g);
+	if (solver_result != 1)
+	{
+		/* Known from the previous solution, no search needed */
+		solver_end = solver_start;
+		solve_show();
+		return;
+	}
+	if (bg_start(&solver, solve_func, &solver_context) != 0)
+	{
+		strncpy(status_text, "Cannot start the solver!", LEN(status_text));
+		status_color = RED;
+	}
+}
+
+static void solve_cancel(void)
+{
+	if (solver.running)
+	{
+		bg_cancel(&solver);
+		strncpy(status_text, "Cancelled!", LEN(status_text));
+		status_color = YELLOW;
+	}
+}
+
+/* Shows the progress, or the result once the solver is done */
+static void solve_update(void)
+{
+	struct timespec now;
+
+	if (!solver.running)
+	{
+		return;
+	}
+	if (!bg_done(&solver))
+	{
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		make_string(status_text, sizeof(status_text),
+				"Solving.. Iterations=%zu, Time=%.1fs ('x' to cancel)",
+				bg_get_progress(&solver), elapsed(&solver_start, &now));
+		status_color = GREEN;
+		return;
+	}
+	bg_join(&solver);
+	solve_show();
+}
+
+/* Runs in the background thread */
+static void check_func(Bg_Job *job)
+{
+	Engine *e = job->arg;
+
+	e->cancel = &job->cancel;
+	checker_result = engine_count(e, 2);
+}
+
+static void check_cancel(void)
+{
+	if (checker.running)
+	{
+		bg_cancel(&checker);
+	}
+}
+
+/* Counts the solutions of the clues (fixed cells) in the background.
+ * A check that is still running is for old clues and gets cancelled.
+ */
+static void check_start(void)
+{
+	Grid g;
+	size_t i;
+
+	check_cancel();
+	clues_changed = false;
+	for (i = 0; i < GRID_CELLS; i++)
+	{
+		g[i] = fixed[i/9][i%9] ? (unsigned char)cells[i/9][i%9] : 0;
+	}
+	if (engine_init(&checker_engine, g) != 0)
+	{
+		num_solutions = 0;
+		return;
+	}
+	/* Stays unknown if the thread cannot be started */
+	num_solutions = -1;
+	bg_start(&checker, check_func, &checker_engine);
+}
+
+static void check_update(void)
+{
+	if (bg_done(&checker))
+	{
+		bg_join(&checker);
+		num_solutions = checker_result;
+	}
+}
+
+/* Runs in the background thread, and starts the workers */
+static void bulk_func(Bg_Job *job)
+{
+	Bulk *b = job->arg;
+
+	b->cancel = &job->cancel;
+	bulk_result = bulk_run(b);
+	clock_gettime(CLOCK_MONOTONIC, &bulk_end);
+}
+
+static void bulk_cancel(void)
+{
+	if (bulk_job.running)
+	{
+		bg_cancel(&bulk_job);
+		bulk_free(&bulk);
+		strncpy(status_text, "Cancelled!", LEN(status_text));
+		status_color = YELLOW;
+	}
+}
+
+/* Solves every puzzle file of the working directory, with all cores */
+static void handle_key_S(void)
+{
+	if (bulk_job.running)
+	{
+		return;
+	}
+	if (bulk_init(&bulk, wdir) != 0)
+	{
+		make_string(status_text, sizeof(status_text), "Cannot read `%s'",
+				wdir);
+		status_color = RED;
+		return;
+	}
+	if (bulk.num == 0)
+	{
+		bulk_free(&bulk);
+		strncpy(status_text, "No files to solve", LEN(status_text));
+		status_color = YELLOW;
+		return;
+	}
+	clock_gettime(CLOCK_MONOTONIC, &bulk_start);
+	if (bg_start(&bulk_job, bulk_func, &bulk) != 0)
+	{
+		bulk_free(&bulk);
+		strncpy(status_text, "Cannot start the solver!", LEN(status_text));
+		status_color = RED;
+	}
+}
+
+/* Shows a progress bar with throughput and time left, or the counts
+ * once all puzzles are done
+ */
+static void bulk_update(void)
+{
+	char bar[BULK_BAR_LEN + 1], path[PATH_MAX];
+	struct timespec now;
+	size_t counts[4], done, i;
+	double t, rate;
+
+	if (!bulk_job.running)
+	{
+		return;
+	}
+	if (!bg_done(&bulk_job))
 	{
-		clock_gettime(CLOCK_MONOTONIC, &tp0);
-		fp = popen(cmd, "r");
-		if (fp)
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		done = atomic_load_explicit(&bulk.done, memory_order_relaxed);
+		t = elapsed(&bulk_start, &now);
+		rate = (t > 0) ? done / t : 0;
+		for (i = 0; i < BULK_BAR_LEN; i++)
 		{
-			if (fscanf(fp, "i=%zu\n", iterations) == 1)
-			{
-				while (i < 81 && (c = fgetc(fp)) != EOF)
-				{
-					if (c > '0' && c <= '9')
-					{
-						c -= '0';
-						y = i/9;
-						x = i%9;
-						/* If it's a fixed cell, then the returned value
-						 * must equal the stored value.
-						 */
-						if (fixed[y][x])
-						{
-							if (c == cells[y][x])
-							{
-								i++;
-							}
-							else
-							{
-								break;
-							}
-						}
-						else
-						{
-							cells[y][x] = c;
-							i++;
-						}
-					}
-				}
-			}
-			/* This is the return code of the solver or calling Shell */
-			ret = pclose(fp);
-			clock_gettime(CLOCK_MONOTONIC,&tp1);
-			tp->tv_sec = tp1.tv_sec - tp0.tv_sec;
-			if (tp0.tv_nsec > tp1.tv_nsec)
-			{
-				tp->tv_sec--;
-				tp->tv_nsec = tp0.tv_nsec - tp1.tv_nsec;
-			}
-			else
-			{
-				tp->tv_nsec = tp1.tv_nsec - tp0.tv_nsec;
-			}
+			bar[i] = (i < done * BULK_BAR_LEN / bulk.num) ? '#' : '-';
 		}
+		bar[BULK_BAR_LEN] = '\0';
+		make_string(status_text, sizeof(status_text),
+				"Solving all.. [%s] %zu/%zu\n"
+				"%.0f files/s, ETA %.1fs ('x' to cancel)", bar, done,
+				bulk.num, rate,
+				(rate > 0) ? (bulk.num - done) / rate : 0.0);
+		status_color = GREEN;
+		return;
 	}
-	if (fd >= 0)
+	bg_join(&bulk_job);
+	t = elapsed(&bulk_start, &bulk_end);
+	bulk_count(&bulk, counts);
+	if (bulk_result != 0)
 	{
-		/* Delete the temp file */
-		unlink(template);
+		strncpy(status_text, "Cancelled!", LEN(status_text));
+		status_color = YELLOW;
 	}
-	if (i == 81 && ret == 0)
+	else if (make_filepath(wdir, BULK_SUMMARY, path, sizeof(path)) != path ||
+		bulk_write_summary(&bulk, path, t) != 0)
 	{
-		return 0;
+		strncpy(status_text, "Failed to write file: `" BULK_SUMMARY "'",
+				LEN(status_text));
+		status_color = RED;
 	}
-	return (ret == 0) ? -1 : -ret;
+	else
+	{
+		make_string(status_text, sizeof(status_text),
+				"Solved %zu puzzles in %.1fs: %zu unique, %zu not unique, "
+				"%zu no solution\nSee `%s'", counts[0] + counts[1] + counts[2],
+				t, counts[1], counts[2], counts[0], BULK_SUMMARY);
+		status_color = (counts[0] + counts[2] == 0) ? GREEN : YELLOW;
+	}
+	bulk_free(&bulk);
+}
+
+/* Shows the next logical step and applies its eliminations to the
+ * candidates
+ */
+static void handle_key_H(void)
+{
+	Grid g;
+	unsigned short cand[GRID_CELLS];
+	size_t i;
+
+	for (i = 0; i < GRID_CELLS; i++)
+	{
+		g[i] = (unsigned char)cells[i/9][i%9];
+		cand[i] = g[i] ? 0 : (unsigned short)candidates(i%9, i/9);
+	}
+	switch (hint_find(g, cand, &hint))
+	{
+	case HT_NONE:
+		status_color = YELLOW;
+		break;
+	case HT_CONTRADICTION:
+		status_color = RED;
+		break;
+	default:
+		status_color = CYAN;
+		break;
+	}
+	for (i = 0; i < GRID_CELLS; i++)
+	{
+		removed[i/9][i%9] |= hint.eliminate[i];
+	}
+	hint_describe(&hint, status_text, sizeof(status_text));
+	show_hint = true;
 }
 
 static void instructions(void)
@@ -355,14 +749,293 @@ static void instructions(void)
 	" 1-9 : Place number under cursor\n"
 	" DEL : Delete number under cursor\n"
 	"   c : Clear all numbers\n"
+	"   u : Undo\n"
+	"  Ctrl-R : Redo\n"
+	"   m : Show/hide candidates of the selected cell\n"
 	"   r : Read Sudoku from file\n"
+	"   b : Browse the puzzles of the working directory\n"
 	"   w : Write Sudoku to file\n"
+	"   t : Replay a trace of the solver\n"
+	"   n : Next puzzle of a collection\n"
+	"   p : Previous puzzle of a collection\n"
+	"   g : Go to puzzle number\n"
+	"   H : Hint, show the next logical step\n"
 	"   s : Solve\n"
+	"   S : Solve all puzzles of the working directory\n"
+	"   x : Cancel solving\n"
+	"  Ctrl-L : Redraw the screen\n"
+	"  Paste : Import a puzzle of 81 cells\n"
 	"   q : Quit\n"
 	"\n"
 	" [ Press enter ]");
 }
 
+/* Shows line n of the collection.
+ * Returns 0 on success, -1 if there is no such line.
+ */
+static int show_entry(size_t n)
+{
+	const char *line;
+	size_t len, i;
+	Grid g;
+
+	if (collection_get(&collection, n, &line, &len) != 0)
+	{
+		return -1;
+	}
+	entry = n;
+	if (grid_parse(g, line, len) != 0)
+	{
+		memset(g, 0, sizeof(g));
+		make_string(status_text, sizeof(status_text),
+				"Line %zu is not a puzzle", n + 1);
+		status_color = RED;
+	}
+	for (i = 0; i < GRID_CELLS; i++)
+	{
+		set_cell(i%9, i/9, g[i], g[i] != 0);
+	}
+	/* The history belongs to the previous puzzle */
+	undo_reset(&undo);
+	return 0;
+}
+
+/* Opens a file with one puzzle, or a collection of puzzles with one per
+ * line.
+ * Returns 0 on success, else -1.
+ */
+static int open_file(const char *path)
+{
+	const char *line;
+	size_t len;
+
+	if (in_collection)
+	{
+		collection_close(&collection);
+		in_collection = false;
+	}
+	if (collection_open(&collection, path) == 0)
+	{
+		/* A second line that is not empty */
+		if (collection_get(&collection, 1, &line, &len) == 0 && len > 0)
+		{
+			in_collection = true;
+			return show_entry(0);
+		}
+		collection_close(&collection);
+	}
+	return read_puzzle(path);
+}
+
+static void handle_key_n(int step)
+{
+	if (!in_collection)
+	{
+		return;
+	}
+	if ((step < 0 && entry == 0) || show_entry(entry + step) != 0)
+	{
+		strncpy(status_text, step < 0 ? "First puzzle" : "Last puzzle",
+				LEN(status_text));
+		status_color = YELLOW;
+	}
+}
+
+static void handle_key_g(void)
+{
+	char *answer, *end;
+	unsigned long n;
+	long count;
+
+	if (!in_collection)
+	{
+		return;
+	}
+	count = collection_count(&collection);
+	if (count >= 0)
+		answer = make_string(message, sizeof(message),
+				"Go to puzzle (1-%ld)\n\n%s\n\n> ", count, msg_cancel);
+	else
+		answer = make_string(message, sizeof(message),
+				"Go to puzzle\n\n%s\n\n> ", msg_cancel);
+	if (answer == NULL)
+	{
+		return;
+	}
+	answer = prompt(message);
+	trim(answer);
+	if (EMPTY(answer))
+	{
+		return;
+	}
+	errno = 0;
+	n = strtoul(answer, &end, 10);
+	if (errno != 0 || *end != '\0' || n == 0 || show_entry(n - 1) != 0)
+	{
+		make_string(status_text, sizeof(status_text), "No puzzle `%s'",
+				answer);
+		status_color = RED;
+	}
+}
+
+static Color level_color(Level level)
+{
+	switch (level)
+	{
+	case LV_EASY:
+		return GREEN;
+	case LV_MEDIUM:
+		return YELLOW;
+	case LV_HARD:
+		return RED;
+	default:
+		return MAGENTA;
+	}
+}
+
+/* The puzzle as 9 rows of digits and dots */
+static void draw_preview(const Lib_Entry *e, size_t x, size_t y)
+{
+	char row[18];
+	size_t i, j;
+
+	for (i = 0; i < 9; i++)
+	{
+		for (j = 0; j < 9; j++)
+		{
+			row[j*2] = e->grid[i*9 + j] ? '0' + e->grid[i*9 + j] : '.';
+			row[j*2 + 1] = ' ';
+		}
+		row[17] = '\0';
+		tui_text(x, y + i, row, SYS_DEFAULT, SYS_DEFAULT, NORMAL);
+	}
+}
+
+static void draw_browser(const Library *lib, const size_t *list, size_t num,
+		size_t sel, size_t top)
+{
+	char line[128];
+	const Lib_Entry *e;
+	Style sty;
+	size_t i, x;
+
+	tui_begin();
+	make_string(line, sizeof(line), "Library: %zu puzzles, %zu read",
+			num, lib->num_read);
+	tui_text(0, 0, line, SYS_DEFAULT, SYS_DEFAULT, NORMAL);
+	tui_text(0, 1, "Name                         Clues State  Level",
+			SYS_DEFAULT, SYS_DEFAULT, BOLD);
+	for (i = top; i < num && i < top + BROWSER_ROWS; i++)
+	{
+		e = &lib->entries[list[i]];
+		sty = (i == sel) ? INVERTED : NORMAL;
+		snprintf(line, sizeof(line), "%-28.28s %5u %-6s ", e->name,
+				e->clues, e->solved ? "solved" : "open");
+		x = tui_text(0, BROWSER_TOP + i - top, line, SYS_DEFAULT,
+				SYS_DEFAULT, sty);
+		tui_text(x, BROWSER_TOP + i - top,
+				e->solved ? "-" : library_level_name(e->level),
+				e->solved ? SYS_DEFAULT : level_color(e->level),
+				SYS_DEFAULT, sty);
+	}
+	if (num > 0)
+	{
+		draw_preview(&lib->entries[list[sel]], BROWSER_PREVIEW_X,
+				BROWSER_TOP);
+	}
+	else
+	{
+		tui_text(0, BROWSER_TOP, "No puzzles in the working directory",
+				YELLOW, SYS_DEFAULT, NORMAL);
+	}
+	tui_text(0, BROWSER_TOP + BROWSER_ROWS + 1,
+			"[jk] move, [JK] page, Enter open, q back",
+			SYS_DEFAULT, SYS_DEFAULT, NORMAL);
+	tui_flush(0, BROWSER_TOP + sel - top);
+}
+
+/* Lists the puzzles of the working directory and opens the one chosen */
+static void handle_key_b(void)
+{
+	Library lib;
+	size_t *list, num = 0, sel = 0, top = 0, i;
+	int c;
+	bool done = false;
+
+	if (library_open(&lib, wdir) != 0)
+	{
+		make_string(status_text, sizeof(status_text), "Cannot read `%s'",
+				wdir);
+		status_color = RED;
+		return;
+	}
+	list = malloc((lib.num_entries + 1) * sizeof(*list));
+	if (list == NULL)
+	{
+		library_close(&lib);
+		return;
+	}
+	for (i = 0; i < lib.num_entries; i++)
+	{
+		if (lib.entries[i].puzzle)
+			list[num++] = i;
+	}
+
+	while (!done)
+	{
+		if (sel < top)
+			top = sel;
+		else if (sel >= top + BROWSER_ROWS)
+			top = sel - BROWSER_ROWS + 1;
+		draw_browser(&lib, list, num, sel, top);
+		c = terminal_read_key();
+		switch (c)
+		{
+		case 'j':
+		case KEY_ARROW_DOWN:
+			if (sel + 1 < num)
+				sel++;
+			break;
+		case 'k':
+		case KEY_ARROW_UP:
+			if (sel > 0)
+				sel--;
+			break;
+		case 'J':
+			sel = (sel + BROWSER_ROWS < num) ? sel + BROWSER_ROWS :
+				(num ? num - 1 : 0);
+			break;
+		case 'K':
+			sel = (sel > BROWSER_ROWS) ? sel - BROWSER_ROWS : 0;
+			break;
+		case '\r':
+		case '\n':
+			if (num > 0 && make_filepath(wdir,
+					lib.entries[list[sel]].name, filepath,
+					sizeof(filepath)) == filepath)
+			{
+				solve_cancel();
+				strncpy(status_text, "", LEN(status_text));
+				if (open_file(filepath) != 0)
+				{
+					make_string(status_text, sizeof(status_text),
+							"Failed to read file: `%s'", filepath);
+					status_color = RED;
+				}
+			}
+			done = true;
+			break;
+		case 'q':
+		case 'b':
+		case EOF:
+			done = true;
+			break;
+		}
+	}
+	free(list);
+	library_close(&lib);
+}
+
 static void handle_key_r(void)
 {
 	int status = -1;
@@ -379,7 +1052,7 @@ static void handle_key_r(void)
 		{
 			if (get_realpath(answer, filepath, sizeof(filepath)) == filepath)
 			{
-				status = read_puzzle(filepath);
+				status = open_file(filepath);
 			}
 			else
 			{
@@ -413,6 +1086,157 @@ static void handle_key_r(void)
 	}
 }
 
+static void draw_replay(const Trace *t, const char *name, size_t speed,
+		bool paused, bool end)
+{
+	char line[128];
+	Text_Cell tc;
+	size_t i, x, y;
+
+	tui_text_cell_init(&tc);
+	for (i = 0; i < GRID_CELLS; i++)
+	{
+		tc.c = t->g[i] ? '0' + t->g[i] : ' ';
+		tc.fg = t->start[i] ? YELLOW : SYS_DEFAULT;
+		tc.bg = ((int)i == t->last_cell) ? MAGENTA : SYS_DEFAULT;
+		translate(i%9, i/9, &x, &y);
+		tui_frame_set(x, y, &tc);
+	}
+	tui_begin();
+	x = tui_text(0, 0, "Replay: ", SYS_DEFAULT, SYS_DEFAULT, NORMAL);
+	tui_text(x, 0, name, CYAN, SYS_DEFAULT, NORMAL);
+	tui_frame_draw();
+	y = FRAME_POS_Y + FRAME_SIZE_Y;
+	/* A frame is one step, or sample steps of a sampled trace */
+	make_string(line, sizeof(line), "Step %zu, %zu steps/s",
+			t->frame * t->sample, speed * t->sample);
+	x = tui_text(0, y, line, SYS_DEFAULT, SYS_DEFAULT, NORMAL);
+	if (end)
+		tui_text(x, y, " - end of trace", GREEN, SYS_DEFAULT, NORMAL);
+	else if (paused)
+		tui_text(x, y, " - paused", YELLOW, SYS_DEFAULT, NORMAL);
+	tui_text(0, y + 2, "[+-] speed, Space pause, [.] next step, "
+			"0 restart, q back", SYS_DEFAULT, SYS_DEFAULT, NORMAL);
+	tui_flush(0, y + 2);
+}
+
+/* Plays a trace of the solver as an animation, at the speed chosen */
+static void replay(Trace *t, const char *name)
+{
+	struct pollfd pfd = { .fd = 0, .events = POLLIN };
+	struct timespec last, now;
+	size_t speed = REPLAY_SPEED;
+	/* Frames owed by the time passed */
+	double due = 0;
+	bool paused = false, end = false, pending;
+
+	clock_gettime(CLOCK_MONOTONIC, &last);
+	for (;;)
+	{
+		draw_replay(t, name, speed, paused, end);
+		/* Keys read along with the last one are not seen by poll() */
+		pending = terminal_key_pending();
+		if (!pending &&
+				poll(&pfd, 1, (paused || end) ? -1 : REPLAY_TICK) < 0)
+		{
+			return;
+		}
+		if (pending || (pfd.revents & (POLLIN | POLLHUP)))
+		{
+			switch (terminal_read_key())
+			{
+			case EOF:
+			case 'q':
+				return;
+			case '+':
+				if (speed < REPLAY_SPEED_MAX)
+					speed *= 2;
+				break;
+			case '-':
+				if (speed > 1)
+					speed /= 2;
+				break;
+			case ' ':
+				paused = !paused;
+				break;
+			case '.':
+				paused = true;
+				end = (trace_next(t) != 0);
+				break;
+			case '0':
+				trace_rewind(t);
+				end = false;
+				break;
+			}
+		}
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		if (paused || end)
+		{
+			due = 0;
+		}
+		else
+		{
+			due += speed * elapsed(&last, &now);
+			for (; due >= 1 && !end; due -= 1)
+			{
+				end = (trace_next(t) != 0);
+			}
+		}
+		last = now;
+	}
+}
+
+static void handle_key_t(void)
+{
+	Trace trace;
+	char *answer = NULL, *name;
+	int status = -1;
+
+	filepath[0] = '\0';
+	if (make_string(message, sizeof(message),
+			"%s\n%s\n\n%s\n\nReplay trace of the solver\n> ",
+			msg_cdir, wdir, msg_cancel))
+	{
+		answer = prompt(message);
+		trim(answer);
+		if (NOT_EMPTY(answer))
+		{
+			if (get_realpath(answer, filepath, sizeof(filepath)) == filepath)
+			{
+				status = trace_open(&trace, filepath);
+			}
+			else
+			{
+				perror("realpath");
+			}
+		}
+		else
+		{
+			status = -2;
+		}
+	}
+	if (status == 0)
+	{
+		name = strrchr(filepath, '/');
+		replay(&trace, name ? name + 1 : filepath);
+		trace_free(&trace);
+		return;
+	}
+	if (status == -2)
+	{
+		tui_print("\nCancelled!", YELLOW, SYS_DEFAULT, NORMAL);
+	}
+	else
+	{
+		make_string(message, sizeof(message), "Failed to read trace: `%s'",
+			(filepath[0] != '\0') ? filepath :
+			(answer != NULL) ? answer : "");
+		tui_print(message, RED, SYS_DEFAULT, NORMAL);
+	}
+	printf("\n\n[Press key]");
+	terminal_read_key();
+}
+
 static void handle_key_w(void)
 {
 	int status = -1;
@@ -508,36 +1332,61 @@ static void handle_key_w(void)
 
 static void handle_key_s(void)
 {
-	struct timespec tp;
-	size_t i;
-
-	strncpy(status_text, "Solving. Please wait..", LEN(status_text));
-	status_color = GREEN;
-	draw_all();
-	if (solve(&tp, &i) != 0)
+	if (!solver.running)
 	{
-		strncpy(status_text, "Cannot solve this Sudoku!", LEN(status_text));
-		status_color = RED;
+		strncpy(status_text, "Solving. Please wait..", LEN(status_text));
+		status_color = GREEN;
+		solve_start();
 	}
-	else
+}
+
+/* Imports a pasted puzzle: 81 cells in line format, or 9 lines of 9.
+ * All cells make one undo entry.
+ */
+static void handle_paste(void)
+{
+	char line[TERM_PASTE_MAX];
+	const char *text;
+	size_t len, n = 0, i;
+	Grid g;
+
+	text = terminal_paste(&len);
+	for (i = 0; i < len; i++)
 	{
-		if (!make_string(status_text, sizeof(status_text),
-				"Solved!\nIterations=%zu, Time=%fs", i,
-				(double) tp.tv_sec + ((double) tp.tv_nsec)/1e9))
+		if (text[i] != '\n' && text[i] != '\r' && text[i] != ' ' &&
+				text[i] != '\t')
 		{
-			//TODO: die()
+			line[n++] = text[i];
 		}
-		status_color = GREEN;
+	}
+	if (grid_parse(g, line, n) != 0)
+	{
+		strncpy(status_text, "Pasted text is not a puzzle",
+				LEN(status_text));
+		status_color = YELLOW;
+		return;
+	}
+	for (i = 0; i < GRID_CELLS; i++)
+	{
+		set_cell(i%9, i/9, g[i], g[i] != 0);
 	}
 }
 
 static int handle_key_press(int c)
 {
-	if (c == 'c' || c == 'r' || c == KEY_DEL || (c <= '9' && c > 0))
+	size_t i;
+
+	if (c == 'c' || c == 'r' || c == 'u' || c == KEY_CTRL_R ||
+			c == 'n' || c == 'p' || c == 'g' || c == KEY_PASTE ||
+			c == KEY_DEL || (c > '0' && c <= '9'))
 	{
+		/* The result would no longer fit to the current Sudoku */
+		solve_cancel();
 		/* Status may no longer fit to the current Sudoku */
 		strncpy(status_text, "", LEN(status_text));
 	}
+	/* The highlight belongs to the last key only */
+	show_hint = false;
 	switch (c)
 	{
 	case 'h':
@@ -561,33 +1410,84 @@ static int handle_key_press(int c)
 			cell_x++;
 		break;
 	case KEY_DEL:
-		cells[cell_y][cell_x] = 0;
-		fixed[cell_y][cell_x] = false;
+		set_cell(cell_x, cell_y, 0, false);
 		break;
 	case 'q':
+		solve_cancel();
+		check_cancel();
+		bulk_cancel();
 		return 1;
 		break;
+	case 'x':
+		solve_cancel();
+		bulk_cancel();
+		break;
 	case 'c':
-		memset(cells, 0, sizeof(cells));
-		memset(fixed, 0, sizeof(fixed));
+		for (i = 0; i < GRID_CELLS; i++)
+		{
+			set_cell(i%9, i/9, 0, false);
+		}
+		break;
+	case 'u':
+		if (undo_undo(&undo, undo_apply, NULL) != 0)
+		{
+			strncpy(status_text, "Nothing to undo", LEN(status_text));
+			status_color = YELLOW;
+		}
+		break;
+	case KEY_CTRL_R:
+		if (undo_redo(&undo, undo_apply, NULL) != 0)
+		{
+			strncpy(status_text, "Nothing to redo", LEN(status_text));
+			status_color = YELLOW;
+		}
+		break;
+	case 'm':
+		show_marks = !show_marks;
 		break;
 	case 'r':
 		handle_key_r();
 		break;
+	case 'b':
+		handle_key_b();
+		break;
 	case 'w':
 		handle_key_w();
 		break;
+	case 't':
+		handle_key_t();
+		break;
+	case 'n':
+		handle_key_n(1);
+		break;
+	case 'p':
+		handle_key_n(-1);
+		break;
+	case 'g':
+		handle_key_g();
+		break;
 	case 's':
 		handle_key_s();
 		break;
+	case 'S':
+		handle_key_S();
+		break;
+	case 'H':
+		handle_key_H();
+		break;
+	case KEY_CTRL_L:
+		tui_invalidate();
+		break;
+	case KEY_PASTE:
+		handle_paste();
+		break;
 	case '?':
 		instructions();
 		break;
 	default:
 		if (c > '0' && c <= '9')
 		{
-			cells[cell_y][cell_x] = c-'0';
-			fixed[cell_y][cell_x] = true;
+			set_cell(cell_x, cell_y, c-'0', true);
 		}
 		break;
 	}
@@ -648,9 +1548,17 @@ static void handle_signal(int signum)
 
 int main(int argc, char *argv[])
 {
-	int c;
+	int c, ret;
+	bool quit = false;
 	char *pwd;
 	struct sigaction sigact;
+	struct pollfd pfd[4] =
+	{
+		{ .fd = 0, .events = POLLIN },
+		{ .fd = -1, .events = POLLIN },
+		{ .fd = -1, .events = POLLIN },
+		{ .fd = -1, .events = POLLIN }
+	};
 
 	if (argc >= 1)
 		argv0 = argv[0];
@@ -687,7 +1595,7 @@ int main(int argc, char *argv[])
 		errno = 0;
 		if (get_realpath(argv[1], filepath, sizeof(filepath)) == filepath)
 		{
-			if (read_puzzle(filepath) != 0)
+			if (open_file(filepath) != 0)
 			{
 				return 1;
 			}
@@ -706,6 +1614,11 @@ int main(int argc, char *argv[])
 		printf("usage: %s [file]\n", argv0);
 		return 1;
 	}
+	/* Unbuffered, so that poll() sees every key that is not yet read */
+	setvbuf(stdin, NULL, _IONBF, 0);
+	search_setup();
+	engine_setup();
+	search_context_init(&solver_context);
 	terminal_init();
 	tui_init();
 	tui_frame_init(FRAME_POS_X, FRAME_POS_Y, FRAME_SIZE_X, FRAME_SIZE_Y);
@@ -724,13 +1637,63 @@ int main(int argc, char *argv[])
 		"|   |   |   |"
 		"+---+---+---+";
 	tui_frame_fill(SYS_DEFAULT, SYS_DEFAULT, NORMAL, grid);
+	/* Loading the file given on the command line is not undoable */
+	undo_reset(&undo);
+	check_start();
 	update_grid();
 	draw_all();
-	
-	while ((c = terminal_read_key()) != EOF)
+
+	for (;;)
 	{
-		if (handle_key_press(c) != 0)
+		/* Wake up regularly while a solver runs to show its progress,
+		 * and as soon as it is done.
+		 */
+		pfd[1].fd = bg_fd(&solver);
+		pfd[2].fd = bg_fd(&checker);
+		pfd[3].fd = bg_fd(&bulk_job);
+		ret = poll(pfd, 4, (solver.running || bulk_job.running) ?
+				SOLVE_STATUS_INTERVAL : -1);
+		if (ret < 0)
+		{
+			/* Interrupted, e.g. by Ctrl-C */
+			solve_cancel();
+			check_cancel();
+			bulk_cancel();
 			break;
+		}
+		if (ret > 0 && (pfd[0].revents & (POLLIN | POLLHUP)))
+		{
+			/* Every key typed so far, e.g. of a held arrow key, before
+			 * the screen is drawn once
+			 */
+			do
+			{
+				if ((c = terminal_read_key()) == EOF)
+				{
+					solve_cancel();
+					check_cancel();
+					bulk_cancel();
+					quit = true;
+				}
+				else if (handle_key_press(c) != 0)
+				{
+					quit = true;
+				}
+				/* Each key makes an undo entry of its own */
+				undo_commit(&undo);
+			} while (!quit && terminal_key_pending());
+			if (quit)
+				break;
+		}
+		if (clues_changed)
+		{
+			check_start();
+		}
+		check_update();
+		bulk_update();
+		solve_update();
+		/* All cells changed by a key, or by the solver, make one entry */
+		undo_commit(&undo);
 		update_grid();
 		draw_all();
 	}
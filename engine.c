@@ -0,0 +1,386 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright (c) 2023 Rainer Holzner <rholzner@web.de> */
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdatomic.h>
+#include "grid.h"
+#include "engine.h"
+
+#define ALL_VALUES 0x3fe
+#define MAX_PEERS (GRID_CELLS - 1)
+/* Number of guesses between two checks for cancellation */
+#define CANCEL_CHECK_MASK 255
+
+/* The units of grid_units(), and the cells that share a unit with a
+ * cell (20 in the classic Sudoku). They never change after
+ * engine_setup(), so variants take the same path as the classic Sudoku.
+ */
+static unsigned char units[GRID_MAX_UNITS][9];
+static unsigned num_units;
+static unsigned char peers[GRID_CELLS][MAX_PEERS];
+static unsigned char num_peers[GRID_CELLS];
+
+void engine_setup(void)
+{
+	unsigned i, j, n, cell_no;
+	bool seen[GRID_CELLS];
+
+	num_units = grid_units(units);
+	for (cell_no = 0; cell_no < GRID_CELLS; cell_no++)
+	{
+		memset(seen, 0, sizeof(seen));
+		seen[cell_no] = true;
+		n = 0;
+		for (i = 0; i < num_units; i++)
+		{
+			if (memchr(units[i], cell_no, 9) == NULL)
+			{
+				continue;
+			}
+			for (j = 0; j < 9; j++)
+			{
+				if (!seen[units[i][j]])
+				{
+					seen[units[i][j]] = true;
+					peers[cell_no][n++] = units[i][j];
+				}
+			}
+		}
+		num_peers[cell_no] = (unsigned char)n;
+	}
+}
+
+/* Sets a cell and removes its value from the peers. Peers that are left
+ * with one candidate are set as well, and so on.
+ * Returns 0 on success, -1 on a contradiction.
+ */
+static int place(Engine_State *st, unsigned cell_no, unsigned val)
+{
+	unsigned char todo[GRID_CELLS];
+	unsigned n = 0, i, p, bit;
+
+	if (st->value[cell_no] != 0)
+	{
+		/* Already set, e.g. as a naked single */
+		return (st->value[cell_no] == val) ? 0 : -1;
+	}
+	if (!(st->cand[cell_no] & (1u << val)))
+	{
+		return -1;
+	}
+	st->cand[cell_no] = (unsigned short)(1u << val);
+	st->value[cell_no] = (unsigned char)val;
+	st->blanks--;
+	todo[n++] = (unsigned char)cell_no;
+
+	while (n > 0)
+	{
+		cell_no = todo[--n];
+		bit = st->cand[cell_no];
+		for (i = 0; i < num_peers[cell_no]; i++)
+		{
+			p = peers[cell_no][i];
+			if (!(st->cand[p] & bit))
+			{
+				continue;
+			}
+			if (st->value[p] != 0)
+			{
+				return -1;
+			}
+			st->cand[p] &= (unsigned short)~bit;
+			if (st->cand[p] == 0)
+			{
+				return -1;
+			}
+			if ((st->cand[p] & (st->cand[p] - 1)) == 0)
+			{
+				st->value[p] = (unsigned char)__builtin_ctz(st->cand[p]);
+				st->blanks--;
+				todo[n++] = (unsigned char)p;
+			}
+		}
+	}
+	return 0;
+}
+
+/* Sets the values that fit into only one cell of a unit.
+ * Returns the number of cells set, or -1 on a contradiction.
+ */
+static int hidden_singles(Engine_State *st)
+{
+	unsigned u, i, c, once, twice, placed, singles, bit;
+	int n = 0;
+
+	for (u = 0; u < num_units; u++)
+	{
+		once = twice = placed = 0;
+		for (i = 0; i < 9; i++)
+		{
+			c = st->cand[units[u][i]];
+			twice |= once & c;
+			once |= c;
+			if (st->value[units[u][i]] != 0)
+			{
+				placed |= c;
+			}
+		}
+		if (once != ALL_VALUES)
+		{
+			/* A value has no place left */
+			return -1;
+		}
+		singles = once & ~twice & ~placed;
+		while (singles)
+		{
+			bit = singles & -singles;
+			singles &= ~bit;
+			for (i = 0; i < 9 && !(st->cand[units[u][i]] & bit); i++)
+			{
+			}
+			if (i == 9 ||
+				place(st, units[u][i], __builtin_ctz(bit)) != 0)
+			{
+				return -1;
+			}
+			n++;
+		}
+	}
+	return n;
+}
+
+static int propagate(Engine_State *st)
+{
+	int n;
+
+	while ((n = hidden_singles(st)) > 0)
+	{
+	}
+	return n;
+}
+
+/* Returns the blank cell with the fewest candidates */
+static unsigned pick(const Engine_State *st)
+{
+	unsigned cell_no, best = 0;
+	int count, best_count = 10;
+
+	for (cell_no = 0; cell_no < GRID_CELLS; cell_no++)
+	{
+		if (st->value[cell_no] != 0)
+		{
+			continue;
+		}
+		count = __builtin_popcount(st->cand[cell_no]);
+		if (count < best_count)
+		{
+			best = cell_no;
+			best_count = count;
+			if (count == 2)
+			{
+				break;
+			}
+		}
+	}
+	return best;
+}
+
+int engine_init(Engine *e, const Grid g)
+{
+	Engine_State *st = &e->state;
+	unsigned cell_no;
+
+	e->nodes = 0;
+	for (cell_no = 0; cell_no < GRID_CELLS; cell_no++)
+	{
+		st->cand[cell_no] = ALL_VALUES;
+		st->value[cell_no] = 0;
+	}
+	st->blanks = GRID_CELLS;
+
+	for (cell_no = 0; cell_no < GRID_CELLS; cell_no++)
+	{
+		if (g[cell_no] == 0)
+		{
+			continue;
+		}
+		if (place(st, cell_no, g[cell_no]) != 0)
+		{
+			st->blanks = -1;
+			return -1;
+		}
+	}
+	if (propagate(st) < 0)
+	{
+		st->blanks = -1;
+		return -1;
+	}
+	return 0;
+}
+
+int engine_exclude(Engine *e, unsigned cell_no, unsigned val)
+{
+	Engine_State *st = &e->state;
+	unsigned short cand;
+
+	if (st->blanks < 0)
+	{
+		return -1;
+	}
+	if (st->value[cell_no] != 0)
+	{
+		if (st->value[cell_no] != val)
+		{
+			return 0;
+		}
+		st->blanks = -1;
+		return -1;
+	}
+	cand = st->cand[cell_no] & (unsigned short)~(1u << val);
+	if (cand == st->cand[cell_no])
+	{
+		return 0;
+	}
+	st->cand[cell_no] = cand;
+	/* One candidate left, or none */
+	if ((cand & (cand - 1)) == 0 &&
+		(cand == 0 || place(st, cell_no, __builtin_ctz(cand)) != 0))
+	{
+		st->blanks = -1;
+		return -1;
+	}
+	if (propagate(st) < 0)
+	{
+		st->blanks = -1;
+		return -1;
+	}
+	return 0;
+}
+
+/* The search of engine_count() and engine_enumerate(), found may be NULL.
+ * limit 0 means none.
+ */
+static long long run(Engine *e, long long limit, Engine_Found found,
+		void *arg)
+{
+	Engine_State *st = &e->state;
+	Engine_Frame *f;
+	int depth = 0;
+	long long n = 0;
+	unsigned bit;
+
+	if (st->blanks < 0)
+	{
+		return 0;
+	}
+	for (;;)
+	{
+		if (st->blanks == 0)
+		{
+			if (n++ == 0)
+			{
+				memcpy(e->solution, st->value, GRID_CELLS);
+			}
+			if ((found && found(st->value, arg) != 0) || n == limit)
+			{
+				return n;
+			}
+		}
+		else
+		{
+			f = &e->stack[depth++];
+			f->cell_no = (unsigned char)pick(st);
+			f->untried = st->cand[f->cell_no];
+			f->saved = *st;
+		}
+
+		/* Next guess, go back where all values have been tried */
+		for (;;)
+		{
+			if (depth == 0)
+			{
+				return n;
+			}
+			f = &e->stack[depth-1];
+			if (f->untried == 0)
+			{
+				depth--;
+				continue;
+			}
+			bit = f->untried & -f->untried;
+			f->untried &= (unsigned short)~bit;
+			*st = f->saved;
+			if ((++e->nodes & CANCEL_CHECK_MASK) == 0 && e->cancel &&
+				atomic_load_explicit(e->cancel, memory_order_relaxed))
+			{
+				return -1;
+			}
+			if (place(st, f->cell_no, __builtin_ctz(bit)) == 0 &&
+				propagate(st) == 0)
+			{
+				break;
+			}
+		}
+	}
+}
+
+int engine_count(Engine *e, int limit)
+{
+	return (int)run(e, (limit > 0) ? limit : 1, NULL, NULL);
+}
+
+long long engine_enumerate(Engine *e, Engine_Found found, void *arg)
+{
+	return run(e, 0, found, arg);
+}
+
+int engine_split(Engine *e, Engine_State parts[], int max)
+{
+	Engine_State parent, child;
+	unsigned cell_no, cand, bit;
+	int n = 0, i, best;
+
+	if (e->state.blanks < 0 || max < 1)
+	{
+		return 0;
+	}
+	parts[n++] = e->state;
+	for (;;)
+	{
+		/* The part with the most blank cells, likely the largest */
+		best = -1;
+		for (i = 0; i < n; i++)
+		{
+			if (parts[i].blanks > 0 &&
+				(best < 0 || parts[i].blanks > parts[best].blanks))
+			{
+				best = i;
+			}
+		}
+		if (best < 0)
+		{
+			return n;
+		}
+		cell_no = pick(&parts[best]);
+		cand = parts[best].cand[cell_no];
+		if (n - 1 + __builtin_popcount(cand) > max)
+		{
+			return n;
+		}
+		/* Replaced by its children */
+		parent = parts[best];
+		parts[best] = parts[--n];
+		for (; cand; cand &= ~bit)
+		{
+			bit = cand & -cand;
+			child = parent;
+			if (place(&child, cell_no, __builtin_ctz(bit)) == 0 &&
+				propagate(&child) == 0)
+			{
+				parts[n++] = child;
+			}
+		}
+	}
+}
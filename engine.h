@@ -0,0 +1,88 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright (c) 2023 Rainer Holzner <rholzner@web.de> */
+
+#ifndef _ENGINE_H_
+#define _ENGINE_H_
+
+#include <stddef.h>
+#include <stdatomic.h>
+#include "grid.h"
+
+/* Candidates of all cells as bit masks, bit v for value v */
+typedef struct _engine_state
+{
+	unsigned short cand[GRID_CELLS];
+	Grid value;
+	/* Number of blank cells */
+	int blanks;
+} Engine_State;
+
+typedef struct _engine_frame
+{
+	Engine_State saved;
+	unsigned char cell_no;
+	/* Values of cell_no not tried yet */
+	unsigned short untried;
+} Engine_Frame;
+
+/* Constraint propagation (naked and hidden singles) with a depth-first
+ * search on the cell with the fewest candidates. The search uses an
+ * explicit stack instead of recursion.
+ * Each thread must use its own instance.
+ */
+typedef struct _engine
+{
+	Engine_State state;
+	/* At most one guess per cell */
+	Engine_Frame stack[GRID_CELLS];
+	/* The first solution found by engine_count() */
+	Grid solution;
+	/* Number of guesses */
+	size_t nodes;
+	/* engine_count() stops soon after it becomes true. May be NULL. */
+	atomic_bool *cancel;
+} Engine;
+
+/* Builds the unit and peer tables from grid_units().
+ * Must be called once before any other engine function.
+ */
+void engine_setup(void);
+
+/* Takes the values of g as clues.
+ * Returns 0 on success, -1 if the clues contradict each other.
+ */
+int engine_init(Engine *e, const Grid g);
+
+/* Removes val from the candidates of a cell, after engine_init().
+ * Returns 0 on success, -1 if no solution is left; engine_count() then
+ * finds none.
+ */
+int engine_exclude(Engine *e, unsigned cell_no, unsigned val);
+
+/* Called by engine_enumerate() for each solution. A nonzero return value
+ * stops the search.
+ */
+typedef int (*Engine_Found)(const Grid solution, void *arg);
+
+/* Counts the solutions, but stops at limit (at least 1).
+ * Leaves the state changed, call engine_init() before counting again.
+ * Returns the number of solutions found, 0 if there is none, or -1 if
+ * cancelled.
+ */
+int engine_count(Engine *e, int limit);
+
+/* Like engine_count() without a limit, but calls found for each
+ * solution in search order.
+ * Returns the number of solutions found, or -1 if cancelled.
+ */
+long long engine_enumerate(Engine *e, Engine_Found found, void *arg);
+
+/* Splits the search after engine_init() into at most max parts, by
+ * guessing the values of cells like the search does. Each part is a state
+ * to continue from (set e->state to it), and together they have the same
+ * solutions. Parts without solution are left out.
+ * Returns the number of parts.
+ */
+int engine_split(Engine *e, Engine_State parts[], int max);
+
+#endif
@@ -0,0 +1,273 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright (c) 2023 Rainer Holzner <rholzner@web.de> */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "grid.h"
+#include "engine.h"
+#include "enumerate.h"
+#include "progress.h"
+
+/* Parts of the search per thread, so that the threads that are done
+ * early take more
+ */
+#define PARTS_PER_THREAD 16
+#define OUTPUT_BUFFER_SIZE (1 << 16)
+#define LINE_LEN (GRID_LINE_LEN + 1)
+
+typedef struct _writer
+{
+	pthread_t thread;
+	Engine engine;
+	char buf[OUTPUT_BUFFER_SIZE];
+	size_t len;
+	/* Published for the progress report, only the writer changes them.
+	 * Solutions written, and the nodes of the engine up to the last one.
+	 */
+	atomic_ullong count;
+	atomic_ullong nodes;
+	/* Part in work and its start time, 0 if idle */
+	atomic_int busy_part;
+	atomic_ullong busy_since;
+} Writer;
+
+static Writer *writers;
+static size_t num_writers;
+static Engine_State *parts;
+static int num_parts;
+static atomic_int next_part;
+static atomic_int parts_done;
+static uint64_t run_start;
+static Progress progress;
+static unsigned long long limit;
+/* Solutions taken so far, counted only with a limit */
+static atomic_ullong taken;
+/* Set once the limit is reached or STDOUT failed, stops all threads */
+static atomic_bool stop;
+static bool write_error;
+/* Keeps the buffers of the threads from mixing */
+static pthread_mutex_t output_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static uint64_t now_ns(void)
+{
+	struct timespec tp;
+
+	clock_gettime(CLOCK_MONOTONIC, &tp);
+	return (uint64_t)tp.tv_sec * 1000000000u + (uint64_t)tp.tv_nsec;
+}
+
+/* Blocks while STDOUT is full, e.g. a pipe the reader is slow on */
+static void flush(Writer *w)
+{
+	const char *p = w->buf;
+	size_t len = w->len;
+	ssize_t n;
+
+	pthread_mutex_lock(&output_lock);
+	while (len > 0 && !write_error)
+	{
+		n = write(STDOUT_FILENO, p, len);
+		if (n == -1)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+			perror("write");
+			write_error = true;
+			atomic_store_explicit(&stop, true, memory_order_relaxed);
+			break;
+		}
+		p += n;
+		len -= (size_t)n;
+	}
+	pthread_mutex_unlock(&output_lock);
+	w->len = 0;
+}
+
+static int found(const Grid solution, void *arg)
+{
+	Writer *w = arg;
+	unsigned long long n;
+
+	if (limit)
+	{
+		n = atomic_fetch_add_explicit(&taken, 1, memory_order_relaxed);
+		if (n >= limit)
+		{
+			return 1;
+		}
+		if (n + 1 == limit)
+		{
+			/* The last one, written below */
+			atomic_store_explicit(&stop, true, memory_order_relaxed);
+		}
+	}
+	if (w->len + LINE_LEN > sizeof(w->buf))
+	{
+		flush(w);
+	}
+	grid_format(solution, w->buf + w->len);
+	w->buf[w->len + GRID_LINE_LEN] = '\n';
+	w->len += LINE_LEN;
+	atomic_store_explicit(&w->count, 1 +
+			atomic_load_explicit(&w->count, memory_order_relaxed),
+			memory_order_relaxed);
+	atomic_store_explicit(&w->nodes, w->engine.nodes, memory_order_relaxed);
+	return atomic_load_explicit(&stop, memory_order_relaxed);
+}
+
+static void *worker_main(void *arg)
+{
+	Writer *w = arg;
+	int i;
+
+	w->engine.cancel = &stop;
+	while (!atomic_load_explicit(&stop, memory_order_relaxed) &&
+		(i = atomic_fetch_add_explicit(&next_part, 1,
+			memory_order_relaxed)) < num_parts)
+	{
+		atomic_store_explicit(&w->busy_part, i, memory_order_relaxed);
+		atomic_store_explicit(&w->busy_since, now_ns(),
+				memory_order_relaxed);
+		w->engine.state = parts[i];
+		engine_enumerate(&w->engine, found, w);
+		atomic_store_explicit(&w->nodes, w->engine.nodes,
+				memory_order_relaxed);
+		atomic_store_explicit(&w->busy_since, 0, memory_order_relaxed);
+		atomic_fetch_add_explicit(&parts_done, 1, memory_order_relaxed);
+	}
+	flush(w);
+	return NULL;
+}
+
+/* Prints the solutions so far, the parts done, the rates and the part
+ * that is in work for the longest time
+ */
+static void report_progress(void *arg)
+{
+	Writer *w;
+	uint64_t now, ns, since, oldest = 0;
+	unsigned long long count = 0, nodes = 0;
+	size_t i;
+	int part = 0;
+
+	(void)arg;
+	for (i = 0; i < num_writers; i++)
+	{
+		w = &writers[i];
+		count += atomic_load_explicit(&w->count, memory_order_relaxed);
+		nodes += atomic_load_explicit(&w->nodes, memory_order_relaxed);
+		since = atomic_load_explicit(&w->busy_since, memory_order_relaxed);
+		if (since && (oldest == 0 || since < oldest))
+		{
+			oldest = since;
+			part = atomic_load_explicit(&w->busy_part,
+					memory_order_relaxed);
+		}
+	}
+	now = now_ns();
+	ns = now - run_start;
+	fprintf(stderr, "progress solutions=%llu parts=%d/%d time=%.3fs "
+			"rate=%.1f/s nodes=%.0f/s", count,
+			atomic_load_explicit(&parts_done, memory_order_relaxed),
+			num_parts, (double)ns / 1e9,
+			ns ? (double)count * 1e9 / (double)ns : 0.0,
+			ns ? (double)nodes * 1e9 / (double)ns : 0.0);
+	if (oldest && now > oldest)
+	{
+		fprintf(stderr, " in-flight=%d %.3fs", part,
+				(double)(now - oldest) / 1e9);
+	}
+	fputc('\n', stderr);
+}
+
+int enumerate_run(const Grid g, size_t threads, unsigned long long lim,
+		bool stats, unsigned progress_interval)
+{
+	unsigned long long count = 0;
+	uint64_t t0;
+	size_t i, num_threads;
+	long cpus;
+	int ret = 0;
+
+	t0 = run_start = now_ns();
+	limit = lim;
+	num_threads = threads;
+	if (num_threads == 0)
+	{
+		cpus = sysconf(_SC_NPROCESSORS_ONLN);
+		num_threads = (cpus > 0) ? (size_t)cpus : 1;
+	}
+	engine_setup();
+	writers = calloc(num_threads, sizeof(*writers));
+	/* A single thread keeps the search order */
+	parts = malloc((num_threads > 1 ? num_threads * PARTS_PER_THREAD : 1) *
+			sizeof(*parts));
+	if (!writers || !parts)
+	{
+		perror("malloc");
+		free(writers);
+		free(parts);
+		return 1;
+	}
+	num_parts = 0;
+	if (engine_init(&writers[0].engine, g) == 0)
+	{
+		num_parts = engine_split(&writers[0].engine, parts,
+				(num_threads > 1) ?
+				(int)(num_threads * PARTS_PER_THREAD) : 1);
+	}
+	num_writers = num_threads;
+	/* Before the threads, so that they do not take SIGUSR1 */
+	if (progress_start(&progress, progress_interval, report_progress,
+			NULL) < 0)
+	{
+		free(writers);
+		free(parts);
+		return 1;
+	}
+	/* writers[0] is the calling thread */
+	for (i = 1; i < num_threads; i++)
+	{
+		if (pthread_create(&writers[i].thread, NULL, worker_main,
+				&writers[i]) != 0)
+		{
+			perror("pthread_create");
+			num_threads = i;
+			break;
+		}
+	}
+	worker_main(&writers[0]);
+	for (i = 0; i < num_threads; i++)
+	{
+		if (i > 0)
+		{
+			pthread_join(writers[i].thread, NULL);
+		}
+		count += writers[i].count;
+	}
+	progress_stop(&progress);
+	if (stats)
+	{
+		t0 = now_ns() - t0;
+		fprintf(stderr, "solutions=%llu time=%.3fs rate=%.1f/s "
+				"threads=%zu\n", count, (double)t0 / 1e9,
+				t0 ? (double)count * 1e9 / (double)t0 : 0.0,
+				num_threads);
+	}
+	free(writers);
+	free(parts);
+	if (write_error)
+		ret = 1;
+	else if (count == 0)
+		ret = 3;
+	return ret;
+}
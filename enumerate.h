@@ -0,0 +1,28 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright (c) 2023 Rainer Holzner <rholzner@web.de> */
+
+#ifndef _ENUMERATE_H_
+#define _ENUMERATE_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "grid.h"
+
+/* Writes all solutions of g to STDOUT, one line of 81 digits each, or at
+ * most limit of them if limit is not 0. The memory used does not depend
+ * on the number of solutions: each thread fills a buffer and writes it
+ * out, and waits while STDOUT does not take more.
+ * With more than one thread, the search is split into parts that the
+ * threads take one after the other, and the order of the solutions
+ * varies from run to run. threads 0 means one per online CPU.
+ * With stats, the number of solutions and the rate are printed to STDERR.
+ * The progress is printed to STDERR on SIGUSR1, and every
+ * progress_interval seconds unless it is 0.
+ *
+ * Returns the exit status of the solver: 0 if there is a solution, 1 on
+ * I/O errors, otherwise 3.
+ */
+int enumerate_run(const Grid g, size_t threads, unsigned long long limit,
+		bool stats, unsigned progress_interval);
+
+#endif
@@ -0,0 +1,51 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright (c) 2023 Rainer Holzner <rholzner@web.de> */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include "grid.h"
+#include "search.h"
+#include "engine.h"
+#include "crosscheck.h"
+
+/* Entry points for libFuzzer (clang -fsanitize=fuzzer): the input is
+ * taken as a line of the batch mode, and a puzzle is run through all
+ * engines, which must agree.
+ */
+
+/* Keeps slow searches from looking like hangs */
+#define FUZZ_BUDGET 100000
+
+int LLVMFuzzerInitialize(int *argc, char ***argv);
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size);
+
+/* Only one instance, it is too large for the stack */
+static Crosscheck check;
+
+int LLVMFuzzerInitialize(int *argc, char ***argv)
+{
+	(void)argc;
+	(void)argv;
+	search_setup();
+	engine_setup();
+	check.engine.cancel = NULL;
+	check.budget = FUZZ_BUDGET;
+	return 0;
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+	Grid g;
+
+	if (grid_parse(g, (const char *)data, size) != 0)
+	{
+		return 0;
+	}
+	if (crosscheck_puzzle(&check, g) == 1)
+	{
+		fprintf(stderr, "%s\n", check.why);
+		abort();
+	}
+	return 0;
+}
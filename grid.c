@@ -0,0 +1,332 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright (c) 2023 Rainer Holzner <rholzner@web.de> */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include "grid.h"
+
+/* The units besides the rows and columns. They never change after
+ * grid_load_variant().
+ */
+typedef struct _grid_variant
+{
+	/* Box or region number of each cell */
+	unsigned char region[GRID_CELLS];
+	unsigned num_extra;
+	unsigned char extra[GRID_MAX_EXTRA][9];
+} Grid_Variant;
+
+/* The boxes of the classic Sudoku */
+static Grid_Variant variant =
+{
+	{
+		0, 0, 0, 1, 1, 1, 2, 2, 2,
+		0, 0, 0, 1, 1, 1, 2, 2, 2,
+		0, 0, 0, 1, 1, 1, 2, 2, 2,
+		3, 3, 3, 4, 4, 4, 5, 5, 5,
+		3, 3, 3, 4, 4, 4, 5, 5, 5,
+		3, 3, 3, 4, 4, 4, 5, 5, 5,
+		6, 6, 6, 7, 7, 7, 8, 8, 8,
+		6, 6, 6, 7, 7, 7, 8, 8, 8,
+		6, 6, 6, 7, 7, 7, 8, 8, 8
+	},
+	0,
+	{ { 0 } }
+};
+
+int grid_parse(Grid g, const char *line, size_t len)
+{
+	size_t i;
+	char c;
+
+	while (len > 0 && (line[len-1] == '\n' || line[len-1] == '\r'))
+	{
+		len--;
+	}
+	if (len != GRID_LINE_LEN)
+	{
+		return -1;
+	}
+	for (i = 0; i < GRID_CELLS; i++)
+	{
+		c = line[i];
+		g[i] = (c > '0' && c <= '9') ? (unsigned char)(c - '0') : 0;
+	}
+	return 0;
+}
+
+void grid_format(const Grid g, char *buf)
+{
+	size_t i;
+
+	for (i = 0; i < GRID_CELLS; i++)
+	{
+		buf[i] = g[i] ? (char)('0' + g[i]) : '.';
+	}
+}
+
+/* Every cell is read exactly once and updates the masks of its row,
+ * column and box. A value that is already set in one of the masks is
+ * a duplicate. The loop body has no branches, so a blank cell simply
+ * contributes an empty bit. The extra units work the same way; the
+ * classic Sudoku has none.
+ */
+int grid_check(const Grid g)
+{
+	unsigned rows[9] = { 0 }, cols[9] = { 0 }, boxes[9] = { 0 };
+	unsigned dup = 0, blank = 0;
+	unsigned x, y, i, u, mask, bit;
+
+	for (y = 0, i = 0; y < 9; y++)
+	{
+		for (x = 0; x < 9; x++, i++)
+		{
+			bit = (1u << g[i]) & ~1u;
+			blank += (bit == 0);
+			dup |= (rows[y] & bit) | (cols[x] & bit) |
+				(boxes[variant.region[i]] & bit);
+			rows[y] |= bit;
+			cols[x] |= bit;
+			boxes[variant.region[i]] |= bit;
+		}
+	}
+	for (u = 0; u < variant.num_extra; u++)
+	{
+		for (i = 0, mask = 0; i < 9; i++)
+		{
+			bit = (1u << g[variant.extra[u][i]]) & ~1u;
+			dup |= mask & bit;
+			mask |= bit;
+		}
+	}
+	return dup ? -1 : (int)blank;
+}
+
+/* Reads the next 9 lines into map, each must have 9 characters.
+ * Returns 0 on success, else -1.
+ */
+static int read_map(FILE *fp, char **line, size_t *size, size_t *line_no,
+		char map[GRID_CELLS])
+{
+	ssize_t len;
+	unsigned y;
+
+	for (y = 0; y < 9; y++)
+	{
+		if ((len = getline(line, size, fp)) == -1)
+		{
+			return -1;
+		}
+		(*line_no)++;
+		while (len > 0 && strchr(" \t\r\n", (*line)[len-1]))
+		{
+			len--;
+		}
+		if (len != 9)
+		{
+			return -1;
+		}
+		memcpy(map + y*9, *line, 9);
+	}
+	return 0;
+}
+
+/* Adds a unit for each character of map, in the order they first
+ * appear. Cells marked with blank are in no unit.
+ * Returns the number of units added, or -1 if there are more than max
+ * or one has not exactly 9 cells.
+ */
+static int map_units(const char map[GRID_CELLS], char blank,
+		unsigned char units[][9], unsigned max)
+{
+	int index[256];
+	unsigned count[GRID_MAX_UNITS] = { 0 };
+	unsigned i, u, n = 0;
+	unsigned char c;
+
+	for (i = 0; i < 256; i++)
+	{
+		index[i] = -1;
+	}
+	for (i = 0; i < GRID_CELLS; i++)
+	{
+		c = (unsigned char)map[i];
+		if (c == (unsigned char)blank)
+		{
+			continue;
+		}
+		if (index[c] < 0)
+		{
+			if (n == max)
+			{
+				return -1;
+			}
+			index[c] = (int)n++;
+		}
+		u = (unsigned)index[c];
+		if (count[u] == 9)
+		{
+			return -1;
+		}
+		units[u][count[u]++] = (unsigned char)i;
+	}
+	for (u = 0; u < n; u++)
+	{
+		if (count[u] != 9)
+		{
+			return -1;
+		}
+	}
+	return (int)n;
+}
+
+static int add_extra(Grid_Variant *v, const unsigned char cells[9])
+{
+	if (v->num_extra == GRID_MAX_EXTRA)
+	{
+		return -1;
+	}
+	memcpy(v->extra[v->num_extra++], cells, 9);
+	return 0;
+}
+
+/* Parses one line of a region file, the maps of "regions" and "extra"
+ * are read from fp.
+ * Returns 0 on success, else -1.
+ */
+static int parse_line(Grid_Variant *v, const char *word, FILE *fp,
+		char **line, size_t *size, size_t *line_no)
+{
+	unsigned char units[GRID_MAX_UNITS][9];
+	char map[GRID_CELLS];
+	unsigned i, j;
+	int n;
+
+	if (strcmp(word, "diagonals") == 0)
+	{
+		for (i = 0; i < 9; i++)
+		{
+			units[0][i] = (unsigned char)(i*10);
+			units[1][i] = (unsigned char)(i*8+8);
+		}
+		return (add_extra(v, units[0]) == 0 &&
+			add_extra(v, units[1]) == 0) ? 0 : -1;
+	}
+	if (strcmp(word, "windoku") == 0)
+	{
+		/* 3x3 windows at rows and columns 2-4 and 6-8 */
+		for (n = 0; n < 4; n++)
+		{
+			for (i = 0; i < 9; i++)
+			{
+				j = (1 + (n/2)*4 + i/3)*9 + 1 + (n%2)*4 + i%3;
+				units[0][i] = (unsigned char)j;
+			}
+			if (add_extra(v, units[0]) != 0)
+			{
+				return -1;
+			}
+		}
+		return 0;
+	}
+	if (strcmp(word, "regions") == 0)
+	{
+		if (read_map(fp, line, size, line_no, map) != 0 ||
+			map_units(map, '\0', units, 9) != 9)
+		{
+			return -1;
+		}
+		for (i = 0; i < 9; i++)
+		{
+			for (j = 0; j < 9; j++)
+			{
+				v->region[units[i][j]] = (unsigned char)i;
+			}
+		}
+		return 0;
+	}
+	if (strcmp(word, "extra") == 0)
+	{
+		if (read_map(fp, line, size, line_no, map) != 0 ||
+			(n = map_units(map, '.', units,
+				GRID_MAX_EXTRA - v->num_extra)) < 0)
+		{
+			return -1;
+		}
+		for (i = 0; i < (unsigned)n; i++)
+		{
+			add_extra(v, units[i]);
+		}
+		return 0;
+	}
+	return -1;
+}
+
+int grid_load_variant(const char *path, size_t *line_no)
+{
+	Grid_Variant v;
+	char *line = NULL, *word;
+	size_t size = 0;
+	FILE *fp;
+	int ret = 0;
+
+	memcpy(v.region, variant.region, sizeof(v.region));
+	v.num_extra = 0;
+	*line_no = 0;
+	fp = fopen(path, "r");
+	if (fp == NULL)
+	{
+		return -1;
+	}
+	while (ret == 0 && getline(&line, &size, fp) != -1)
+	{
+		(*line_no)++;
+		word = strtok(line, " \t\r\n");
+		if (word == NULL || word[0] == '#')
+		{
+			continue;
+		}
+		if (strtok(NULL, " \t\r\n") != NULL ||
+			parse_line(&v, word, fp, &line, &size, line_no) != 0)
+		{
+			errno = EINVAL;
+			ret = -1;
+		}
+	}
+	if (ret == 0 && ferror(fp))
+	{
+		ret = -1;
+	}
+	free(line);
+	fclose(fp);
+	if (ret == 0)
+	{
+		variant = v;
+	}
+	return ret;
+}
+
+unsigned grid_units(unsigned char units[GRID_MAX_UNITS][9])
+{
+	unsigned i, j, n[9] = { 0 };
+
+	for (i = 0; i < 9; i++)
+	{
+		for (j = 0; j < 9; j++)
+		{
+			units[i][j] = (unsigned char)(i*9+j);
+			units[9+i][j] = (unsigned char)(j*9+i);
+		}
+	}
+	for (i = 0; i < GRID_CELLS; i++)
+	{
+		j = variant.region[i];
+		units[18+j][n[j]++] = (unsigned char)i;
+	}
+	memcpy(units[27], variant.extra, variant.num_extra * sizeof(units[0]));
+	return 27 + variant.num_extra;
+}
@@ -0,0 +1,58 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright (c) 2023 Rainer Holzner <rholzner@web.de> */
+
+#ifndef _GRID_H_
+#define _GRID_H_
+
+#include <stddef.h>
+
+#define GRID_CELLS 81
+/* Length of a puzzle in line format, without the line end */
+#define GRID_LINE_LEN GRID_CELLS
+/* Extra units of a variant at most, e.g. the diagonals */
+#define GRID_MAX_EXTRA 27
+/* The rows, columns and regions, and the extra units */
+#define GRID_MAX_UNITS (27 + GRID_MAX_EXTRA)
+
+/* A Sudoku stored row by row.
+ * 0 represents a blank cell, 1-9 a cell value.
+ */
+typedef unsigned char Grid[GRID_CELLS];
+
+/* Parses a puzzle in line format.
+ * Digits between [1..9] represent cell values, all other characters
+ * represent blank cells. A trailing CR and/or LF is ignored.
+ *
+ * Returns 0 on success, -1 if the line does not contain exactly 81 cells.
+ */
+int grid_parse(Grid g, const char *line, size_t len);
+
+/* Writes the grid as 81 characters to buf (not null-terminated).
+ * Blank cells are written as '.'.
+ */
+void grid_format(const Grid g, char *buf);
+
+/* Validates a partial or completed grid in a single pass, plus one pass
+ * over the extra units of a variant.
+ * Returns -1 if any unit contains a value twice, else the number of
+ * blank cells (0 means solved).
+ */
+int grid_check(const Grid g);
+
+/* Replaces the boxes and adds extra units as given in a region file
+ * (see solver(6)), for variants like X-Sudoku or jigsaw Sudoku. Without
+ * it, the units are those of the classic Sudoku.
+ * Must be called before search_setup() and engine_setup(), which build
+ * their tables from grid_units().
+ * Returns 0 on success, else -1 with errno set. If the file is malformed,
+ * errno is EINVAL and *line_no the number of the offending line.
+ */
+int grid_load_variant(const char *path, size_t *line_no);
+
+/* Copies the cell numbers of each unit: the 9 rows, the 9 columns, the
+ * 9 boxes or regions and then the extra units.
+ * Returns the number of units.
+ */
+unsigned grid_units(unsigned char units[GRID_MAX_UNITS][9]);
+
+#endif
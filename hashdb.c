@@ -0,0 +1,365 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright (c) 2023 Rainer Holzner <rholzner@web.de> */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <limits.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "grid.h"
+#include "hashdb.h"
+
+#define HASHDB_MAGIC "sdkhdb1"
+#define TEMP_SUFFIX ".tmp"
+
+/* The layout of the file must not depend on the compiler */
+typedef char slot_size_check[(sizeof(Hashdb_Slot) == 64) ? 1 : -1];
+typedef char header_size_check[(sizeof(Hashdb_Header) == 64) ? 1 : -1];
+
+static uint64_t mix(uint64_t x)
+{
+	x ^= x >> 30;
+	x *= 0xbf58476d1ce4e5b9u;
+	x ^= x >> 27;
+	x *= 0x94d049bb133111ebu;
+	x ^= x >> 31;
+	return x;
+}
+
+/* The puzzle is packed into 4 bits per cell first, so that every way of
+ * writing blank cells gives the same key.
+ */
+static void make_key(const Grid g, uint64_t key[2])
+{
+	uint64_t words[(GRID_CELLS + 15) / 16] = { 0 };
+	uint64_t h0 = 0x243f6a8885a308d3u, h1 = 0x13198a2e03707344u;
+	size_t i;
+
+	for (i = 0; i < GRID_CELLS; i++)
+	{
+		words[i / 16] |= (uint64_t)g[i] << (4 * (i % 16));
+	}
+	for (i = 0; i < sizeof(words) / sizeof(words[0]); i++)
+	{
+		h0 = mix(h0 ^ words[i]);
+		h1 = mix(h1 + words[i] * 0x9e3779b97f4a7c15u);
+	}
+	key[0] = h0;
+	key[1] = h1;
+}
+
+static void pack(const Grid g, unsigned char *packed)
+{
+	size_t i;
+
+	memset(packed, 0, (GRID_CELLS + 1) / 2);
+	for (i = 0; i < GRID_CELLS; i++)
+	{
+		packed[i / 2] |= (unsigned char)(g[i] << (4 * (i % 2)));
+	}
+}
+
+static void unpack(const unsigned char *packed, Grid g)
+{
+	size_t i;
+
+	for (i = 0; i < GRID_CELLS; i++)
+	{
+		g[i] = (packed[i / 2] >> (4 * (i % 2))) & 0xf;
+	}
+}
+
+static size_t slots_for(size_t num)
+{
+	size_t n = HASHDB_MIN_SLOTS;
+
+	while (n / 2 < num && n < HASHDB_MAX_SLOTS)
+	{
+		n *= 2;
+	}
+	return n;
+}
+
+static int create_file(const char *path, size_t num_slots, int flags)
+{
+	Hashdb_Header h;
+	int fd, ret = 0;
+
+	if (num_slots > HASHDB_MAX_SLOTS)
+	{
+		errno = EINVAL;
+		return -1;
+	}
+	fd = open(path, O_RDWR | O_CREAT | flags, 0644);
+	if (fd == -1)
+	{
+		return -1;
+	}
+	memset(&h, 0, sizeof(h));
+	memcpy(h.magic, HASHDB_MAGIC, sizeof(h.magic));
+	h.num_slots = num_slots;
+	/* The slots read as zeros, that is empty, without being written */
+	if (ftruncate(fd, sizeof(h) + num_slots * sizeof(Hashdb_Slot)) == -1 ||
+		pwrite(fd, &h, sizeof(h), 0) != (ssize_t)sizeof(h))
+	{
+		ret = -1;
+	}
+	if (close(fd) == -1)
+	{
+		ret = -1;
+	}
+	return ret;
+}
+
+int hashdb_create(const char *path, size_t num)
+{
+	if (num > HASHDB_MAX_SLOTS / 2)
+	{
+		errno = EINVAL;
+		return -1;
+	}
+	return create_file(path, slots_for(num), O_EXCL);
+}
+
+int hashdb_open(Hashdb *db, const char *path, bool writable)
+{
+	struct stat st;
+	void *map;
+	const Hashdb_Header *h;
+	int fd;
+
+	memset(db, 0, sizeof(*db));
+	fd = open(path, writable ? O_RDWR : O_RDONLY);
+	if (fd == -1)
+	{
+		return -1;
+	}
+	if (fstat(fd, &st) == -1)
+	{
+		close(fd);
+		return -1;
+	}
+	if ((size_t)st.st_size < sizeof(Hashdb_Header))
+	{
+		close(fd);
+		errno = EINVAL;
+		return -1;
+	}
+	map = mmap(NULL, st.st_size, PROT_READ | (writable ? PROT_WRITE : 0),
+			MAP_SHARED, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED)
+	{
+		return -1;
+	}
+	h = map;
+	if (memcmp(h->magic, HASHDB_MAGIC, sizeof(h->magic)) != 0 ||
+		h->num_slots == 0 || (h->num_slots & (h->num_slots - 1)) != 0 ||
+		h->num_slots > HASHDB_MAX_SLOTS || h->count > h->num_slots ||
+		(size_t)st.st_size != sizeof(*h) + h->num_slots * sizeof(Hashdb_Slot))
+	{
+		munmap(map, st.st_size);
+		errno = EINVAL;
+		return -1;
+	}
+	db->map = map;
+	db->map_size = st.st_size;
+	db->header = map;
+	db->slots = (Hashdb_Slot *)(db->header + 1);
+	db->num_slots = h->num_slots;
+	db->writable = writable;
+	return 0;
+}
+
+void hashdb_close(Hashdb *db)
+{
+	if (db->map)
+	{
+		munmap(db->map, db->map_size);
+	}
+	memset(db, 0, sizeof(*db));
+}
+
+/* Returns the slot of the key, or the empty slot where it would go */
+static Hashdb_Slot *find(const Hashdb *db, const uint64_t key[2])
+{
+	size_t mask = db->num_slots - 1, i, n;
+	Hashdb_Slot *s;
+
+	i = key[0] & mask;
+	for (n = 0; n < db->num_slots; n++)
+	{
+		s = &db->slots[i];
+		if (s->result == HR_NONE ||
+			(s->key[0] == key[0] && s->key[1] == key[1]))
+		{
+			return s;
+		}
+		i = (i + 1) & mask;
+	}
+	/* Only if the file was filled beyond the limit by others */
+	return NULL;
+}
+
+Hashdb_Result hashdb_get(const Hashdb *db, const Grid g, Grid solution)
+{
+	const Hashdb_Slot *s;
+	uint64_t key[2];
+	size_t i;
+
+	make_key(g, key);
+	s = find(db, key);
+	if (s == NULL || s->result == HR_NONE)
+	{
+		return HR_NONE;
+	}
+	if (s->result == HR_SOLVED)
+	{
+		unpack(s->solution, solution);
+		/* A solution that does not fit the clues is from another puzzle
+		 * with the same key
+		 */
+		for (i = 0; i < GRID_CELLS; i++)
+		{
+			if (g[i] && g[i] != solution[i])
+			{
+				return HR_NONE;
+			}
+		}
+	}
+	return (Hashdb_Result)s->result;
+}
+
+int hashdb_put(Hashdb *db, const Grid g, Hashdb_Result r,
+		const Grid solution)
+{
+	Hashdb_Slot *s;
+	uint64_t key[2];
+
+	if (!db->writable)
+	{
+		errno = EBADF;
+		return -1;
+	}
+	make_key(g, key);
+	s = find(db, key);
+	if (s && s->result != HR_NONE)
+	{
+		return 1;
+	}
+	if (s == NULL || (db->header->count + 1) * 100 >
+			(uint64_t)db->num_slots * HASHDB_MAX_LOAD)
+	{
+		errno = ENOSPC;
+		return -1;
+	}
+	s->key[0] = key[0];
+	s->key[1] = key[1];
+	if (r == HR_SOLVED)
+		pack(solution, s->solution);
+	/* Last, so that a reader never finds a slot half written */
+	s->result = (unsigned char)r;
+	db->header->count++;
+	return 0;
+}
+
+int hashdb_rebuild(const char *path, size_t num_slots)
+{
+	char temp[PATH_MAX + sizeof(TEMP_SUFFIX)];
+	Hashdb old, db;
+	const Hashdb_Slot *s;
+	Hashdb_Slot *t;
+	size_t i;
+	int ret = 0;
+
+	if ((size_t)snprintf(temp, sizeof(temp), "%s" TEMP_SUFFIX, path) >=
+			sizeof(temp))
+	{
+		errno = ENAMETOOLONG;
+		return -1;
+	}
+	if (hashdb_open(&old, path, false) != 0)
+	{
+		return -1;
+	}
+	if (num_slots == 0)
+	{
+		num_slots = slots_for(old.header->count);
+	}
+	if ((num_slots & (num_slots - 1)) != 0 || num_slots > HASHDB_MAX_SLOTS ||
+		num_slots * HASHDB_MAX_LOAD < old.header->count * 100)
+	{
+		hashdb_close(&old);
+		errno = EINVAL;
+		return -1;
+	}
+	if (create_file(temp, num_slots, O_TRUNC) != 0 ||
+		hashdb_open(&db, temp, true) != 0)
+	{
+		hashdb_close(&old);
+		unlink(temp);
+		return -1;
+	}
+	/* The slots are copied as they are, only their place changes */
+	for (i = 0; i < old.num_slots; i++)
+	{
+		s = &old.slots[i];
+		if (s->result == HR_NONE)
+		{
+			continue;
+		}
+		t = find(&db, s->key);
+		if (t->result == HR_NONE)
+		{
+			*t = *s;
+			db.header->count++;
+		}
+	}
+	if (msync(db.map, db.map_size, MS_SYNC) == -1)
+	{
+		ret = -1;
+	}
+	hashdb_close(&db);
+	hashdb_close(&old);
+	if (ret == 0 && rename(temp, path) == -1)
+	{
+		ret = -1;
+	}
+	if (ret != 0)
+	{
+		unlink(temp);
+	}
+	return ret;
+}
+
+void hashdb_stat(const Hashdb *db, Hashdb_Stat *st)
+{
+	const Hashdb_Slot *s;
+	size_t mask = db->num_slots - 1, i, probe, total = 0;
+
+	memset(st, 0, sizeof(*st));
+	st->num_slots = db->num_slots;
+	for (i = 0; i < db->num_slots; i++)
+	{
+		s = &db->slots[i];
+		if (s->result == HR_NONE)
+		{
+			continue;
+		}
+		st->count++;
+		if (s->result == HR_SOLVED)
+			st->solved++;
+		else
+			st->unsolvable++;
+		probe = ((i - (s->key[0] & mask)) & mask) + 1;
+		total += probe;
+		if (probe > st->max_probe)
+			st->max_probe = probe;
+	}
+	st->mean_probe = st->count ? (double)total / st->count : 0;
+}
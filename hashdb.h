@@ -0,0 +1,97 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright (c) 2023 Rainer Holzner <rholzner@web.de> */
+
+#ifndef _HASHDB_H_
+#define _HASHDB_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <limits.h>
+#include "grid.h"
+
+/* Slots of a new store at least, and the most of them in use in percent */
+#define HASHDB_MIN_SLOTS 1024
+#define HASHDB_MAX_LOAD 75
+/* Slots of a store at most, so that its size, and the number of slots
+ * times 100, fit into a size_t
+ */
+#define HASHDB_MAX_SLOTS ((size_t)1 << (sizeof(size_t) * CHAR_BIT - 8))
+
+typedef enum _hashdb_result
+{
+	HR_NONE,
+	HR_SOLVED,
+	HR_UNSOLVABLE
+} Hashdb_Result;
+
+/* One cache line: the key, the solution with two cells per byte (the
+ * first in the low nibble) and the result, 0 for an empty slot.
+ */
+typedef struct _hashdb_slot
+{
+	uint64_t key[2];
+	unsigned char solution[(GRID_CELLS + 1) / 2];
+	unsigned char result;
+	unsigned char reserved[6];
+} Hashdb_Slot;
+
+typedef struct _hashdb_header
+{
+	char magic[8];
+	uint64_t num_slots;
+	uint64_t count;
+	unsigned char reserved[40];
+} Hashdb_Header;
+
+/* A file of puzzles and their solutions: the header followed by an open
+ * addressing hash table with linear probing, mapped into memory. The key
+ * is a 128 bit hash of the puzzle. The file has the byte order of the
+ * machine that created it.
+ */
+typedef struct _hashdb
+{
+	void *map;
+	size_t map_size;
+	Hashdb_Header *header;
+	Hashdb_Slot *slots;
+	/* A power of 2 */
+	size_t num_slots;
+	bool writable;
+} Hashdb;
+
+typedef struct _hashdb_stat
+{
+	size_t num_slots, count, solved, unsolvable;
+	/* Slots looked at to find an entry */
+	size_t max_probe;
+	double mean_probe;
+} Hashdb_Stat;
+
+/* Creates an empty store for about num puzzles. Fails if the file
+ * exists, or with EINVAL if num needs more than HASHDB_MAX_SLOTS slots.
+ * Returns 0 on success, else -1 with errno set.
+ */
+int hashdb_create(const char *path, size_t num);
+/* Returns 0 on success, else -1 with errno set */
+int hashdb_open(Hashdb *db, const char *path, bool writable);
+void hashdb_close(Hashdb *db);
+
+/* Looks up puzzle g. The solution is set if the result is HR_SOLVED. */
+Hashdb_Result hashdb_get(const Hashdb *db, const Grid g, Grid solution);
+/* Adds puzzle g, existing entries are kept as they are.
+ * Returns 0 if added, 1 if already there, -1 if the store is full.
+ */
+int hashdb_put(Hashdb *db, const Grid g, Hashdb_Result r,
+		const Grid solution);
+
+/* Copies all entries into a new file with num_slots slots, or the fewest
+ * that keep it at most half full if num_slots is 0, and replaces the
+ * store with it. num_slots must be a power of 2 up to HASHDB_MAX_SLOTS.
+ * Returns 0 on success, else -1 with errno set.
+ */
+int hashdb_rebuild(const char *path, size_t num_slots);
+
+void hashdb_stat(const Hashdb *db, Hashdb_Stat *st);
+
+#endif
@@ -0,0 +1,474 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright (c) 2023 Rainer Holzner <rholzner@web.de> */
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include "grid.h"
+#include "hint.h"
+
+#define NUM_UNITS 27
+
+static const char *names[] =
+{
+	[HT_NONE] = "No hint",
+	[HT_CONTRADICTION] = "Contradiction",
+	[HT_NAKED_SINGLE] = "Naked single",
+	[HT_HIDDEN_SINGLE] = "Hidden single",
+	[HT_POINTING] = "Pointing",
+	[HT_CLAIMING] = "Claiming",
+	[HT_NAKED_PAIR] = "Naked pair",
+	[HT_HIDDEN_PAIR] = "Hidden pair"
+};
+
+/* Cell number of the i-th cell of unit u */
+static unsigned unit_cell(unsigned u, unsigned i)
+{
+	if (u < 9)
+		return u*9 + i;
+	if (u < 18)
+		return i*9 + (u-9);
+	u -= 18;
+	return ((u/3)*3 + i/3)*9 + (u%3)*3 + i%3;
+}
+
+static unsigned cell_box(unsigned cell_no)
+{
+	return 18 + (cell_no/27)*3 + (cell_no%9)/3;
+}
+
+static bool in_unit(unsigned cell_no, unsigned u)
+{
+	if (u < 9)
+		return cell_no/9 == u;
+	if (u < 18)
+		return cell_no%9 == u-9;
+	return cell_box(cell_no) == u;
+}
+
+/* Returns the number of the lowest bit set, 32 if none is */
+static unsigned first_bit(unsigned mask)
+{
+	unsigned i = 0;
+
+	while (i < 32 && !(mask & (1u << i)))
+	{
+		i++;
+	}
+	return i;
+}
+
+static unsigned count_bits(unsigned mask)
+{
+	unsigned n = 0;
+
+	for (; mask; mask &= mask - 1)
+	{
+		n++;
+	}
+	return n;
+}
+
+/* Cells of unit u that may take value v, bit i for the i-th cell */
+static unsigned places(const Grid g, const unsigned short cand[],
+		unsigned u, unsigned v)
+{
+	unsigned i, c, mask = 0;
+
+	for (i = 0; i < 9; i++)
+	{
+		c = unit_cell(u, i);
+		if (g[c] == 0 && (cand[c] & (1u << v)))
+		{
+			mask |= 1u << i;
+		}
+	}
+	return mask;
+}
+
+/* Values set in unit u */
+static unsigned placed(const Grid g, unsigned u)
+{
+	unsigned i, mask = 0;
+
+	for (i = 0; i < 9; i++)
+	{
+		mask |= 1u << g[unit_cell(u, i)];
+	}
+	return mask & ~1u;
+}
+
+static void add_cause(Hint *h, unsigned cell_no)
+{
+	if (h->num_cause < 9)
+	{
+		h->cause[h->num_cause++] = (unsigned char)cell_no;
+	}
+}
+
+static void add_cause_places(Hint *h, unsigned u, unsigned mask)
+{
+	unsigned i;
+
+	for (i = 0; i < 9; i++)
+	{
+		if (mask & (1u << i))
+		{
+			add_cause(h, unit_cell(u, i));
+		}
+	}
+}
+
+static void eliminate(Hint *h, const Grid g, const unsigned short cand[],
+		unsigned cell_no, unsigned values)
+{
+	unsigned remove = cand[cell_no] & values;
+
+	if (g[cell_no] == 0 && remove != 0)
+	{
+		h->eliminate[cell_no] |= (unsigned short)remove;
+		h->num_eliminated++;
+	}
+}
+
+static Hint_Technique contradiction(const Grid g,
+		const unsigned short cand[], Hint *h)
+{
+	unsigned c, u, v;
+
+	for (c = 0; c < GRID_CELLS; c++)
+	{
+		if (g[c] == 0 && cand[c] == 0)
+		{
+			h->cell_no = (int)c;
+			return HT_CONTRADICTION;
+		}
+	}
+	for (u = 0; u < NUM_UNITS; u++)
+	{
+		for (v = 1; v <= 9; v++)
+		{
+			if (!(placed(g, u) & (1u << v)) && places(g, cand, u, v) == 0)
+			{
+				h->unit = u;
+				h->values = 1u << v;
+				return HT_CONTRADICTION;
+			}
+		}
+	}
+	return HT_NONE;
+}
+
+static Hint_Technique naked_single(const Grid g,
+		const unsigned short cand[], Hint *h)
+{
+	unsigned c;
+
+	for (c = 0; c < GRID_CELLS; c++)
+	{
+		if (g[c] == 0 && count_bits(cand[c]) == 1)
+		{
+			h->cell_no = (int)c;
+			h->values = cand[c];
+			h->unit = c/9;
+			return HT_NAKED_SINGLE;
+		}
+	}
+	return HT_NONE;
+}
+
+static Hint_Technique hidden_single(const Grid g,
+		const unsigned short cand[], Hint *h)
+{
+	unsigned u, v, mask;
+
+	/* Boxes first, they are the easiest to spot */
+	for (u = NUM_UNITS; u-- > 0;)
+	{
+		for (v = 1; v <= 9; v++)
+		{
+			mask = places(g, cand, u, v);
+			if (count_bits(mask) == 1)
+			{
+				h->cell_no = (int)unit_cell(u, first_bit(mask));
+				h->values = 1u << v;
+				h->unit = u;
+				return HT_HIDDEN_SINGLE;
+			}
+		}
+	}
+	return HT_NONE;
+}
+
+/* The places of a value in a box are all in one row or column, so it
+ * cannot be elsewhere in that row or column.
+ */
+static Hint_Technique pointing(const Grid g,
+		const unsigned short cand[], Hint *h)
+{
+	unsigned b, v, i, mask, lines[2], line, l, c, first;
+
+	for (b = 18; b < NUM_UNITS; b++)
+	{
+		for (v = 1; v <= 9; v++)
+		{
+			mask = places(g, cand, b, v);
+			if (count_bits(mask) < 2)
+			{
+				continue;
+			}
+			first = unit_cell(b, first_bit(mask));
+			lines[0] = first/9;
+			lines[1] = 9 + first%9;
+			for (l = 0; l < 2; l++)
+			{
+				line = lines[l];
+				for (i = 0; i < 9; i++)
+				{
+					if ((mask & (1u << i)) && !in_unit(unit_cell(b, i), line))
+						break;
+				}
+				if (i == 9)
+				{
+					for (i = 0; i < 9; i++)
+					{
+						c = unit_cell(line, i);
+						if (!in_unit(c, b))
+						{
+							eliminate(h, g, cand, c, 1u << v);
+						}
+					}
+					if (h->num_eliminated > 0)
+					{
+						h->unit = b;
+						h->other_unit = line;
+						h->values = 1u << v;
+						add_cause_places(h, b, mask);
+						return HT_POINTING;
+					}
+				}
+			}
+		}
+	}
+	return HT_NONE;
+}
+
+/* The places of a value in a row or column are all in one box, so it
+ * cannot be elsewhere in that box.
+ */
+static Hint_Technique claiming(const Grid g,
+		const unsigned short cand[], Hint *h)
+{
+	unsigned u, v, i, mask, box, c;
+
+	for (u = 0; u < 18; u++)
+	{
+		for (v = 1; v <= 9; v++)
+		{
+			mask = places(g, cand, u, v);
+			if (count_bits(mask) < 2)
+			{
+				continue;
+			}
+			box = cell_box(unit_cell(u, first_bit(mask)));
+			for (i = 0; i < 9; i++)
+			{
+				if ((mask & (1u << i)) && !in_unit(unit_cell(u, i), box))
+					break;
+			}
+			if (i < 9)
+			{
+				continue;
+			}
+			for (i = 0; i < 9; i++)
+			{
+				c = unit_cell(box, i);
+				if (!in_unit(c, u))
+				{
+					eliminate(h, g, cand, c, 1u << v);
+				}
+			}
+			if (h->num_eliminated > 0)
+			{
+				h->unit = u;
+				h->other_unit = box;
+				h->values = 1u << v;
+				add_cause_places(h, u, mask);
+				return HT_CLAIMING;
+			}
+		}
+	}
+	return HT_NONE;
+}
+
+/* Two cells of a unit with the same two candidates take these two
+ * values, so no other cell of the unit can.
+ */
+static Hint_Technique naked_pair(const Grid g,
+		const unsigned short cand[], Hint *h)
+{
+	unsigned u, i, j, k, a, b;
+
+	for (u = 0; u < NUM_UNITS; u++)
+	{
+		for (i = 0; i < 9; i++)
+		{
+			a = unit_cell(u, i);
+			if (g[a] != 0 || count_bits(cand[a]) != 2)
+			{
+				continue;
+			}
+			for (j = i+1; j < 9; j++)
+			{
+				b = unit_cell(u, j);
+				if (g[b] != 0 || cand[b] != cand[a])
+				{
+					continue;
+				}
+				for (k = 0; k < 9; k++)
+				{
+					if (k != i && k != j)
+					{
+						eliminate(h, g, cand, unit_cell(u, k), cand[a]);
+					}
+				}
+				if (h->num_eliminated > 0)
+				{
+					h->unit = u;
+					h->values = cand[a];
+					add_cause(h, a);
+					add_cause(h, b);
+					return HT_NAKED_PAIR;
+				}
+			}
+		}
+	}
+	return HT_NONE;
+}
+
+/* Two values that fit only into the same two cells of a unit must go
+ * there, so these cells cannot take other values.
+ */
+static Hint_Technique hidden_pair(const Grid g,
+		const unsigned short cand[], Hint *h)
+{
+	unsigned u, v, w, mask, pair, i;
+
+	for (u = 0; u < NUM_UNITS; u++)
+	{
+		for (v = 1; v <= 9; v++)
+		{
+			mask = places(g, cand, u, v);
+			if (count_bits(mask) != 2)
+			{
+				continue;
+			}
+			for (w = v+1; w <= 9; w++)
+			{
+				if (places(g, cand, u, w) != mask)
+				{
+					continue;
+				}
+				pair = (1u << v) | (1u << w);
+				for (i = 0; i < 9; i++)
+				{
+					if (mask & (1u << i))
+					{
+						eliminate(h, g, cand, unit_cell(u, i),
+								~pair & 0x3fe);
+					}
+				}
+				if (h->num_eliminated > 0)
+				{
+					h->unit = u;
+					h->values = pair;
+					add_cause_places(h, u, mask);
+					return HT_HIDDEN_PAIR;
+				}
+			}
+		}
+	}
+	return HT_NONE;
+}
+
+Hint_Technique hint_find(const Grid g, const unsigned short cand[GRID_CELLS],
+		Hint *h)
+{
+	static Hint_Technique (*const techniques[])(const Grid,
+			const unsigned short[], Hint *) =
+	{
+		contradiction, naked_single, hidden_single, pointing, claiming,
+		naked_pair, hidden_pair
+	};
+	size_t i;
+
+	memset(h, 0, sizeof(*h));
+	h->cell_no = -1;
+	for (i = 0; i < sizeof(techniques)/sizeof(techniques[0]); i++)
+	{
+		h->technique = techniques[i](g, cand, h);
+		if (h->technique != HT_NONE)
+		{
+			break;
+		}
+	}
+	return h->technique;
+}
+
+static int unit_name(unsigned u, char *buf, size_t size)
+{
+	static const char *kinds[] = { "row", "column", "box" };
+
+	return snprintf(buf, size, "%s %u", kinds[u/9], u%9 + 1);
+}
+
+void hint_describe(const Hint *h, char *buf, size_t size)
+{
+	char unit[16], other[16], values[16];
+	unsigned v, v2;
+
+	unit_name(h->unit, unit, sizeof(unit));
+	unit_name(h->other_unit, other, sizeof(other));
+	v = first_bit(h->values);
+	v2 = first_bit(h->values & ~(1u << v));
+	if (v2 <= 9)
+		snprintf(values, sizeof(values), "%u and %u", v, v2);
+	else
+		snprintf(values, sizeof(values), "%u", v);
+
+	switch (h->technique)
+	{
+	case HT_CONTRADICTION:
+		if (h->cell_no >= 0)
+			snprintf(buf, size, "%s: no value fits r%dc%d",
+					names[h->technique], h->cell_no/9 + 1,
+					h->cell_no%9 + 1);
+		else
+			snprintf(buf, size, "%s: %s has no place in %s",
+					names[h->technique], values, unit);
+		break;
+	case HT_NAKED_SINGLE:
+		snprintf(buf, size, "%s: only %s fits r%dc%d",
+				names[h->technique], values, h->cell_no/9 + 1,
+				h->cell_no%9 + 1);
+		break;
+	case HT_HIDDEN_SINGLE:
+		snprintf(buf, size, "%s: %s fits only one cell of %s",
+				names[h->technique], values, unit);
+		break;
+	case HT_POINTING:
+	case HT_CLAIMING:
+		snprintf(buf, size, "%s: %s in %s lies in %s, removed from %u cells",
+				names[h->technique], values, unit, other,
+				h->num_eliminated);
+		break;
+	case HT_NAKED_PAIR:
+	case HT_HIDDEN_PAIR:
+		snprintf(buf, size, "%s: %s in %s, removed from %u cells",
+				names[h->technique], values, unit, h->num_eliminated);
+		break;
+	default:
+		snprintf(buf, size, "%s found", names[HT_NONE]);
+		break;
+	}
+}
@@ -0,0 +1,58 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright (c) 2023 Rainer Holzner <rholzner@web.de> */
+
+#ifndef _HINT_H_
+#define _HINT_H_
+
+#include <stddef.h>
+#include "grid.h"
+
+/* In the order they are tried, simplest first */
+typedef enum _hint_technique
+{
+	HT_NONE,
+	HT_CONTRADICTION,
+	HT_NAKED_SINGLE,
+	HT_HIDDEN_SINGLE,
+	HT_POINTING,
+	HT_CLAIMING,
+	HT_NAKED_PAIR,
+	HT_HIDDEN_PAIR
+} Hint_Technique;
+
+/* One logical step */
+typedef struct _hint
+{
+	Hint_Technique technique;
+	/* Unit the step is about: rows 0-8, columns 9-17, boxes 18-26 */
+	unsigned unit;
+	/* For pointing and claiming: the row, column or box the
+	 * eliminations happen in
+	 */
+	unsigned other_unit;
+	/* Values involved, bit v for value v */
+	unsigned values;
+	/* Cell to fill in for singles, the empty cell for a contradiction,
+	 * else -1
+	 */
+	int cell_no;
+	/* Cells that make the step possible */
+	unsigned char cause[9];
+	unsigned num_cause;
+	/* Candidates to remove, bit v for value v */
+	unsigned short eliminate[GRID_CELLS];
+	unsigned num_eliminated;
+} Hint;
+
+/* Finds the next step with the simplest technique that applies.
+ * g holds the values, cand the candidates of the blank cells (bit v for
+ * value v). Candidates that contradict g must already be removed.
+ * Returns the technique, HT_NONE if none applies.
+ */
+Hint_Technique hint_find(const Grid g, const unsigned short cand[GRID_CELLS],
+		Hint *h);
+
+/* Describes the step in one line, e.g. "Hidden single: 5 in row 3" */
+void hint_describe(const Hint *h, char *buf, size_t size);
+
+#endif
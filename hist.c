@@ -0,0 +1,189 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright (c) 2023 Rainer Holzner <rholzner@web.de> */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "hist.h"
+
+static size_t bucket_of(uint64_t value)
+{
+	unsigned msb, shift;
+
+	if (value < HIST_SUB)
+	{
+		return (size_t)value;
+	}
+	msb = 63 - (unsigned)__builtin_clzll(value);
+	shift = msb - HIST_SUB_BITS;
+	return (size_t)(shift + 1) * HIST_SUB +
+		(size_t)((value >> shift) & (HIST_SUB - 1));
+}
+
+/* Largest value that falls into bucket b */
+static uint64_t bucket_upper(size_t b)
+{
+	unsigned shift;
+	uint64_t mantissa;
+
+	if (b < HIST_SUB)
+	{
+		return b;
+	}
+	shift = (unsigned)(b / HIST_SUB) - 1;
+	mantissa = (b % HIST_SUB) | HIST_SUB;
+	return ((mantissa + 1) << shift) - 1;
+}
+
+void hist_init(Hist *h)
+{
+	memset(h, 0, sizeof(*h));
+	h->min = UINT64_MAX;
+}
+
+void hist_add(Hist *h, uint64_t value)
+{
+	h->buckets[bucket_of(value)]++;
+	h->count++;
+	h->sum += value;
+	if (value < h->min)
+		h->min = value;
+	if (value > h->max)
+		h->max = value;
+}
+
+void hist_merge(Hist *dst, const Hist *src)
+{
+	size_t b;
+
+	for (b = 0; b < HIST_BUCKETS; b++)
+	{
+		dst->buckets[b] += src->buckets[b];
+	}
+	dst->count += src->count;
+	dst->sum += src->sum;
+	if (src->min < dst->min)
+		dst->min = src->min;
+	if (src->max > dst->max)
+		dst->max = src->max;
+}
+
+uint64_t hist_percentile(const Hist *h, double p)
+{
+	uint64_t rank, seen = 0, upper;
+	size_t b;
+
+	if (h->count == 0)
+	{
+		return 0;
+	}
+	/* Rank of the value we are looking for, counting from 1 */
+	rank = (uint64_t)((p / 100.0) * (double)h->count + 0.5);
+	if (rank < 1)
+		rank = 1;
+	if (rank > h->count)
+		rank = h->count;
+	for (b = 0; b < HIST_BUCKETS; b++)
+	{
+		seen += h->buckets[b];
+		if (seen >= rank)
+		{
+			upper = bucket_upper(b);
+			return (upper < h->max) ? upper : h->max;
+		}
+	}
+	return h->max;
+}
+
+static void sift_down(Slowest *sl, size_t i)
+{
+	size_t child;
+	Slow_Entry tmp;
+
+	for (;;)
+	{
+		child = 2*i + 1;
+		if (child >= sl->num)
+			break;
+		if (child + 1 < sl->num &&
+				sl->entries[child+1].value < sl->entries[child].value)
+			child++;
+		if (sl->entries[i].value <= sl->entries[child].value)
+			break;
+		tmp = sl->entries[i];
+		sl->entries[i] = sl->entries[child];
+		sl->entries[child] = tmp;
+		i = child;
+	}
+}
+
+static void sift_up(Slowest *sl, size_t i)
+{
+	size_t parent;
+	Slow_Entry tmp;
+
+	while (i > 0)
+	{
+		parent = (i - 1) / 2;
+		if (sl->entries[parent].value <= sl->entries[i].value)
+			break;
+		tmp = sl->entries[i];
+		sl->entries[i] = sl->entries[parent];
+		sl->entries[parent] = tmp;
+		i = parent;
+	}
+}
+
+void slowest_init(Slowest *sl, size_t max)
+{
+	sl->num = 0;
+	sl->max = (max < SLOWEST_MAX) ? max : SLOWEST_MAX;
+}
+
+void slowest_add(Slowest *sl, uint64_t value, size_t index,
+		const Grid puzzle)
+{
+	Slow_Entry *e;
+
+	if (sl->num < sl->max)
+	{
+		e = &sl->entries[sl->num];
+		e->value = value;
+		e->index = index;
+		memcpy(e->puzzle, puzzle, sizeof(e->puzzle));
+		sift_up(sl, sl->num++);
+	}
+	else if (sl->num > 0 && value > sl->entries[0].value)
+	{
+		e = &sl->entries[0];
+		e->value = value;
+		e->index = index;
+		memcpy(e->puzzle, puzzle, sizeof(e->puzzle));
+		sift_down(sl, 0);
+	}
+}
+
+void slowest_merge(Slowest *dst, const Slowest *src)
+{
+	size_t i;
+
+	for (i = 0; i < src->num; i++)
+	{
+		slowest_add(dst, src->entries[i].value, src->entries[i].index,
+				src->entries[i].puzzle);
+	}
+}
+
+static int compare_slow(const void *a, const void *b)
+{
+	const Slow_Entry *ea = a, *eb = b;
+
+	if (ea->value != eb->value)
+		return (ea->value < eb->value) ? 1 : -1;
+	return (ea->index > eb->index) - (ea->index < eb->index);
+}
+
+void slowest_sort(Slowest *sl)
+{
+	qsort(sl->entries, sl->num, sizeof(sl->entries[0]), compare_slow);
+}
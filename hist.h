@@ -0,0 +1,68 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright (c) 2023 Rainer Holzner <rholzner@web.de> */
+
+#ifndef _HIST_H_
+#define _HIST_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include "grid.h"
+
+/* Each power of two is split into 2^HIST_SUB_BITS linear buckets,
+ * so a recorded value is off by at most 1/32 (about 3%).
+ */
+#define HIST_SUB_BITS 5
+#define HIST_SUB (1 << HIST_SUB_BITS)
+#define HIST_BUCKETS ((64 - HIST_SUB_BITS + 1) * HIST_SUB)
+
+/* Maximum number of entries a Slowest list can keep */
+#define SLOWEST_MAX 100
+
+/* Latency histogram with logarithmic buckets.
+ * An instance is not thread-safe. Let each thread record into its own
+ * histogram and merge them at the end.
+ */
+typedef struct _hist
+{
+	uint64_t buckets[HIST_BUCKETS];
+	uint64_t count;
+	uint64_t sum;
+	uint64_t min, max;
+} Hist;
+
+typedef struct _slow_entry
+{
+	uint64_t value;
+	/* Record index of the puzzle */
+	size_t index;
+	Grid puzzle;
+} Slow_Entry;
+
+/* The entries with the largest values seen so far */
+typedef struct _slowest
+{
+	/* Min-heap, the smallest kept value is at entries[0] */
+	Slow_Entry entries[SLOWEST_MAX];
+	size_t num, max;
+} Slowest;
+
+void hist_init(Hist *h);
+void hist_add(Hist *h, uint64_t value);
+void hist_merge(Hist *dst, const Hist *src);
+/* Returns the value below which p percent of all values fall.
+ * The result is the upper bound of the matching bucket, but never
+ * more than the recorded maximum.
+ */
+uint64_t hist_percentile(const Hist *h, double p);
+
+/* Keeps at most max entries, max is clamped to SLOWEST_MAX */
+void slowest_init(Slowest *sl, size_t max);
+void slowest_add(Slowest *sl, uint64_t value, size_t index,
+		const Grid puzzle);
+void slowest_merge(Slowest *dst, const Slowest *src);
+/* Sorts the entries by value, largest first.
+ * The list must not be added to afterwards.
+ */
+void slowest_sort(Slowest *sl);
+
+#endif
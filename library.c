@@ -0,0 +1,378 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright (c) 2023 Rainer Holzner <rholzner@web.de> */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "grid.h"
+#include "engine.h"
+#include "hint.h"
+#include "library.h"
+
+#define LIBRARY_MAGIC "sudoku-library 1"
+#define TEMP_SUFFIX ".tmp"
+
+static const char *level_names[LV_NUM] =
+{
+	[LV_UNKNOWN] = "?",
+	[LV_EASY] = "easy",
+	[LV_MEDIUM] = "medium",
+	[LV_HARD] = "hard",
+	[LV_NOT_UNIQUE] = "not unique",
+	[LV_NO_SOLUTION] = "no solution"
+};
+
+const char *library_level_name(Level level)
+{
+	return (level < LV_NUM) ? level_names[level] : level_names[LV_UNKNOWN];
+}
+
+/* Candidates of a blank cell from the values of its row, column and box */
+static unsigned short candidates(const Grid g, unsigned cell_no)
+{
+	unsigned i, row = cell_no/9, col = cell_no%9;
+	unsigned box = (row/3)*27 + (col/3)*3;
+	unsigned used = 0;
+
+	for (i = 0; i < 9; i++)
+	{
+		used |= 1u << g[row*9 + i];
+		used |= 1u << g[i*9 + col];
+		used |= 1u << g[box + (i/3)*9 + i%3];
+	}
+	return (unsigned short)(0x3fe & ~used);
+}
+
+/* Applies hints until the puzzle is solved or no technique applies.
+ * Returns true if it got solved.
+ */
+static bool solve_by_hints(const Grid puzzle)
+{
+	unsigned short removed[GRID_CELLS] = { 0 };
+	unsigned short cand[GRID_CELLS];
+	Grid g;
+	Hint h;
+	unsigned i;
+	Hint_Technique t;
+
+	memcpy(g, puzzle, sizeof(g));
+	for (;;)
+	{
+		for (i = 0; i < GRID_CELLS; i++)
+		{
+			cand[i] = g[i] ? 0 : (candidates(g, i) & ~removed[i]);
+		}
+		t = hint_find(g, cand, &h);
+		if (t == HT_NONE || t == HT_CONTRADICTION)
+		{
+			break;
+		}
+		if (h.cell_no >= 0)
+		{
+			for (i = 1; i <= 9 && !(h.values & (1u << i)); i++)
+			{
+			}
+			g[h.cell_no] = (unsigned char)i;
+		}
+		for (i = 0; i < GRID_CELLS; i++)
+		{
+			removed[i] |= h.eliminate[i];
+		}
+	}
+	return grid_check(g) == 0;
+}
+
+Level library_rate(const Grid g)
+{
+	Engine e;
+	int n;
+
+	if (engine_init(&e, g) != 0)
+	{
+		return LV_NO_SOLUTION;
+	}
+	e.cancel = NULL;
+	n = engine_count(&e, 2);
+	if (n == 0)
+		return LV_NO_SOLUTION;
+	if (n > 1)
+		return LV_NOT_UNIQUE;
+	/* Propagation alone is naked and hidden singles */
+	if (e.nodes == 0)
+		return LV_EASY;
+	return solve_by_hints(g) ? LV_MEDIUM : LV_HARD;
+}
+
+/* Reads the first line of a file and rates it */
+static void read_entry(Lib_Entry *e, int dir_fd)
+{
+	char line[256];
+	FILE *fp;
+	int fd, blanks;
+
+	e->puzzle = false;
+	fd = openat(dir_fd, e->name, O_RDONLY);
+	if (fd == -1)
+	{
+		return;
+	}
+	fp = fdopen(fd, "r");
+	if (fp == NULL)
+	{
+		close(fd);
+		return;
+	}
+	if (fgets(line, sizeof(line), fp) &&
+		grid_parse(e->grid, line, strlen(line)) == 0)
+	{
+		e->puzzle = true;
+		blanks = grid_check(e->grid);
+		if (blanks < 0)
+		{
+			e->clues = GRID_CELLS;
+			e->solved = false;
+			e->level = LV_NO_SOLUTION;
+		}
+		else
+		{
+			e->clues = GRID_CELLS - (unsigned)blanks;
+			e->solved = (blanks == 0);
+			e->level = e->solved ? LV_UNKNOWN : library_rate(e->grid);
+		}
+	}
+	fclose(fp);
+}
+
+static int compare_entries(const void *a, const void *b)
+{
+	return strcmp(((const Lib_Entry *)a)->name, ((const Lib_Entry *)b)->name);
+}
+
+static int add_entry(Lib_Entry **entries, size_t *num, size_t *capacity,
+		const Lib_Entry *e)
+{
+	Lib_Entry *p;
+
+	if (*num == *capacity)
+	{
+		*capacity = *capacity ? *capacity * 2 : 256;
+		p = realloc(*entries, *capacity * sizeof(*p));
+		if (p == NULL)
+		{
+			return -1;
+		}
+		*entries = p;
+	}
+	(*entries)[(*num)++] = *e;
+	return 0;
+}
+
+/* One line per file: mtime, size, puzzle flag, clues, solved flag,
+ * level, the puzzle ('-' if none) and the name up to the end of the
+ * line.
+ */
+static int load_index(Library *lib, Lib_Entry **entries, size_t *num)
+{
+	char path[PATH_MAX + sizeof(LIBRARY_INDEX) + 1];
+	char puzzle[GRID_LINE_LEN + 1];
+	char *line = NULL;
+	size_t size = 0, capacity = 0;
+	ssize_t len;
+	intmax_t mtime;
+	uintmax_t file_size;
+	int is_puzzle, solved, level, name_pos;
+	unsigned clues;
+	Lib_Entry e;
+	FILE *fp;
+
+	*entries = NULL;
+	*num = 0;
+	snprintf(path, sizeof(path), "%s/%s", lib->dir, LIBRARY_INDEX);
+	fp = fopen(path, "r");
+	if (fp == NULL)
+	{
+		return 0;
+	}
+	len = getline(&line, &size, fp);
+	if (len > 0 && strcmp(line, LIBRARY_MAGIC "\n") == 0)
+	{
+		while ((len = getline(&line, &size, fp)) > 0)
+		{
+			if (line[len-1] == '\n')
+			{
+				line[--len] = '\0';
+			}
+			name_pos = 0;
+			if (sscanf(line, "%jd %ju %d %u %d %d %81s %n", &mtime,
+					&file_size, &is_puzzle, &clues, &solved, &level, puzzle,
+					&name_pos) != 7 || name_pos == 0 || line[name_pos] == '\0')
+			{
+				continue;
+			}
+			memset(&e, 0, sizeof(e));
+			e.mtime = mtime;
+			e.size = file_size;
+			e.puzzle = is_puzzle &&
+				grid_parse(e.grid, puzzle, strlen(puzzle)) == 0;
+			e.clues = clues;
+			e.solved = solved;
+			e.level = (level >= 0 && level < LV_NUM) ? level : LV_UNKNOWN;
+			e.name = strdup(line + name_pos);
+			if (e.name == NULL ||
+				add_entry(entries, num, &capacity, &e) != 0)
+			{
+				free(e.name);
+				break;
+			}
+		}
+	}
+	free(line);
+	fclose(fp);
+	qsort(*entries, *num, sizeof(**entries), compare_entries);
+	return 0;
+}
+
+/* The index is a cache: failing to save it is not an error */
+static void save_index(const Library *lib)
+{
+	char path[PATH_MAX + sizeof(LIBRARY_INDEX) + 1];
+	char temp[sizeof(path) + sizeof(TEMP_SUFFIX)];
+	char puzzle[GRID_LINE_LEN + 1];
+	const Lib_Entry *e;
+	size_t i;
+	FILE *fp;
+	int ok;
+
+	snprintf(path, sizeof(path), "%s/%s", lib->dir, LIBRARY_INDEX);
+	snprintf(temp, sizeof(temp), "%s" TEMP_SUFFIX, path);
+	fp = fopen(temp, "w");
+	if (fp == NULL)
+	{
+		return;
+	}
+	fprintf(fp, LIBRARY_MAGIC "\n");
+	puzzle[GRID_LINE_LEN] = '\0';
+	for (i = 0; i < lib->num_entries; i++)
+	{
+		e = &lib->entries[i];
+		if (e->puzzle)
+			grid_format(e->grid, puzzle);
+		fprintf(fp, "%jd %ju %d %u %d %d %s %s\n", (intmax_t)e->mtime,
+				(uintmax_t)e->size, e->puzzle, e->clues, e->solved,
+				(int)e->level, e->puzzle ? puzzle : "-", e->name);
+	}
+	ok = !ferror(fp);
+	ok = (fclose(fp) == 0) && ok;
+	if (!ok || rename(temp, path) == -1)
+	{
+		unlink(temp);
+	}
+}
+
+int library_open(Library *lib, const char *dir)
+{
+	Lib_Entry *old, *found, key, e;
+	size_t num_old, i, capacity = 0;
+	/* Entries of the index that still have their file */
+	bool *taken;
+	struct dirent *de;
+	struct stat st;
+	DIR *d;
+	bool changed = false;
+
+	memset(lib, 0, sizeof(*lib));
+	if (strlen(dir) >= sizeof(lib->dir))
+	{
+		errno = ENAMETOOLONG;
+		return -1;
+	}
+	strcpy(lib->dir, dir);
+	d = opendir(dir);
+	if (d == NULL)
+	{
+		return -1;
+	}
+	load_index(lib, &old, &num_old);
+	taken = calloc(num_old + 1, sizeof(*taken));
+	if (taken == NULL)
+	{
+		num_old = 0;
+	}
+
+	while ((de = readdir(d)) != NULL)
+	{
+		/* Hidden files, among them the index */
+		if (de->d_name[0] == '.' || strchr(de->d_name, '\n') ||
+			fstatat(dirfd(d), de->d_name, &st, 0) == -1 ||
+			!S_ISREG(st.st_mode))
+		{
+			continue;
+		}
+		key.name = de->d_name;
+		found = bsearch(&key, old, num_old, sizeof(*old), compare_entries);
+		if (found && found->mtime == (int64_t)st.st_mtime &&
+			found->size == (uint64_t)st.st_size)
+		{
+			e = *found;
+			taken[found - old] = true;
+		}
+		else
+		{
+			memset(&e, 0, sizeof(e));
+			e.name = strdup(de->d_name);
+			e.mtime = st.st_mtime;
+			e.size = st.st_size;
+			if (e.name)
+			{
+				read_entry(&e, dirfd(d));
+			}
+			lib->num_read++;
+			changed = true;
+		}
+		if (e.name == NULL ||
+			add_entry(&lib->entries, &lib->num_entries, &capacity, &e) != 0)
+		{
+			free(e.name);
+			break;
+		}
+	}
+	closedir(d);
+
+	/* Entries of files that are gone */
+	for (i = 0; i < num_old; i++)
+	{
+		if (!taken[i])
+		{
+			changed = true;
+			free(old[i].name);
+		}
+	}
+	free(old);
+	free(taken);
+
+	qsort(lib->entries, lib->num_entries, sizeof(*lib->entries),
+			compare_entries);
+	if (changed)
+	{
+		save_index(lib);
+	}
+	return 0;
+}
+
+void library_close(Library *lib)
+{
+	size_t i;
+
+	for (i = 0; i < lib->num_entries; i++)
+	{
+		free(lib->entries[i].name);
+	}
+	free(lib->entries);
+	memset(lib, 0, sizeof(*lib));
+}
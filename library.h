@@ -0,0 +1,67 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright (c) 2023 Rainer Holzner <rholzner@web.de> */
+
+#ifndef _LIBRARY_H_
+#define _LIBRARY_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <limits.h>
+#include "grid.h"
+
+/* Name of the index file in the library directory */
+#define LIBRARY_INDEX ".library"
+
+typedef enum _level
+{
+	LV_UNKNOWN,
+	/* Naked and hidden singles are enough */
+	LV_EASY,
+	/* Needs the techniques of the hint engine beyond singles */
+	LV_MEDIUM,
+	/* Needs guessing */
+	LV_HARD,
+	LV_NOT_UNIQUE,
+	LV_NO_SOLUTION,
+	LV_NUM
+} Level;
+
+typedef struct _lib_entry
+{
+	char *name;
+	/* Of the file when it was read, to find changed files */
+	int64_t mtime;
+	uint64_t size;
+	/* The first line of the file is a puzzle */
+	bool puzzle;
+	Grid grid;
+	unsigned clues;
+	/* All cells are filled in without conflicts */
+	bool solved;
+	Level level;
+} Lib_Entry;
+
+/* The puzzles in a directory, sorted by file name */
+typedef struct _library
+{
+	char dir[PATH_MAX];
+	Lib_Entry *entries;
+	size_t num_entries;
+	/* Files read by the last update, the others came from the index */
+	size_t num_read;
+} Library;
+
+/* Loads the index of dir and brings it up to date: only files that are
+ * new or whose modification time or size changed are read. The index
+ * is saved again if anything changed.
+ * Returns 0 on success, else -1 with errno set.
+ */
+int library_open(Library *lib, const char *dir);
+void library_close(Library *lib);
+
+/* Rates a puzzle */
+Level library_rate(const Grid g);
+const char *library_level_name(Level level);
+
+#endif
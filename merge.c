@@ -0,0 +1,172 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright (c) 2023 Rainer Holzner <rholzner@web.de> */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "batch.h"
+
+#define LEN(s) (sizeof(s)-1)
+/* The trailer is searched for in the last bytes of a shard file */
+#define TRAILER_MAX 128
+
+typedef struct _shard
+{
+	const char *path;
+	FILE *fp;
+	size_t k, n, records;
+} Shard;
+
+static const char *argv0;
+
+static int is_trailer(const char *line)
+{
+	return strncmp(line, SHARD_TRAILER, LEN(SHARD_TRAILER)) == 0;
+}
+
+/* Reads the trailer from the end of the file and rewinds it.
+ * Returns 0 on success, else -1.
+ */
+static int read_trailer(Shard *sh)
+{
+	char buf[TRAILER_MAX + 1];
+	char *line;
+	long size, start;
+	size_t len;
+
+	if (fseek(sh->fp, 0, SEEK_END) != 0 || (size = ftell(sh->fp)) < 0)
+	{
+		perror(sh->path);
+		return -1;
+	}
+	start = (size > TRAILER_MAX) ? size - TRAILER_MAX : 0;
+	if (fseek(sh->fp, start, SEEK_SET) != 0)
+	{
+		perror(sh->path);
+		return -1;
+	}
+	len = fread(buf, 1, (size_t)(size - start), sh->fp);
+	buf[len] = '\0';
+	rewind(sh->fp);
+
+	/* Skip the final line end, then find the start of the last line */
+	while (len > 0 && (buf[len-1] == '\n' || buf[len-1] == '\r'))
+	{
+		buf[--len] = '\0';
+	}
+	line = strrchr(buf, '\n');
+	line = line ? line + 1 : buf;
+	if (!is_trailer(line) ||
+			sscanf(line + LEN(SHARD_TRAILER), " %zu/%zu records=%zu",
+				&sh->k, &sh->n, &sh->records) != 3)
+	{
+		fprintf(stderr, "%s: Error: `%s' is incomplete (no trailer)!\n",
+				argv0, sh->path);
+		return -1;
+	}
+	return 0;
+}
+
+/* Interleaves the shards back into input order.
+ * Returns 0 on success, else -1.
+ */
+static int merge(Shard shards[], size_t num_shards, size_t records)
+{
+	char *line = NULL;
+	size_t line_size = 0;
+	size_t r, k;
+	int ret = 0;
+
+	for (r = 0; r < records && ret == 0; r++)
+	{
+		k = r % num_shards;
+		if (getline(&line, &line_size, shards[k].fp) == -1 ||
+				is_trailer(line))
+		{
+			fprintf(stderr, "%s: Error: Record %zu is missing in `%s'!\n",
+					argv0, r, shards[k].path);
+			ret = -1;
+		}
+		else if (fputs(line, stdout) == EOF)
+		{
+			perror("fputs");
+			ret = -1;
+		}
+	}
+	/* Every shard must end right after its last record */
+	for (k = 0; k < num_shards && ret == 0; k++)
+	{
+		if (getline(&line, &line_size, shards[k].fp) == -1 ||
+				!is_trailer(line))
+		{
+			fprintf(stderr, "%s: Error: `%s' has extra records!\n",
+					argv0, shards[k].path);
+			ret = -1;
+		}
+	}
+	free(line);
+	return ret;
+}
+
+int main(int argc, char *argv[])
+{
+	Shard *shards;
+	size_t num_shards, k;
+	int ret = 0;
+
+	argv0 = argv[0];
+	if (argc < 2)
+	{
+		fprintf(stderr, "usage: %s shard-file...\n", argv0);
+		return 1;
+	}
+	num_shards = (size_t)(argc - 1);
+	shards = calloc(num_shards, sizeof(*shards));
+	if (!shards)
+	{
+		perror("calloc");
+		return 1;
+	}
+
+	for (k = 0; k < num_shards && ret == 0; k++)
+	{
+		shards[k].path = argv[k+1];
+		shards[k].fp = fopen(shards[k].path, "r");
+		if (!shards[k].fp)
+		{
+			perror(shards[k].path);
+			ret = -1;
+		}
+		else if (read_trailer(&shards[k]) < 0)
+		{
+			ret = -1;
+		}
+		else if (shards[k].k != k + 1 || shards[k].n != num_shards ||
+				shards[k].records != shards[0].records)
+		{
+			fprintf(stderr, "%s: Error: `%s' is shard %zu/%zu of %zu "
+					"records, expected shard %zu/%zu of %zu records!\n",
+					argv0, shards[k].path, shards[k].k, shards[k].n,
+					shards[k].records, k + 1, num_shards,
+					shards[0].records);
+			ret = -1;
+		}
+	}
+	if (ret == 0)
+	{
+		ret = merge(shards, num_shards, shards[0].records);
+	}
+	if (fflush(stdout) == EOF)
+	{
+		perror("fflush");
+		ret = -1;
+	}
+
+	for (k = 0; k < num_shards; k++)
+	{
+		if (shards[k].fp)
+			fclose(shards[k].fp);
+	}
+	free(shards);
+	return (ret == 0) ? 0 : 1;
+}
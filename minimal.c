@@ -0,0 +1,93 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright (c) 2023 Rainer Holzner <rholzner@web.de> */
+
+#include <string.h>
+#include "grid.h"
+#include "engine.h"
+#include "minimal.h"
+
+/* Returns 0 if the solution of g is unique, -1 if there is none and -2
+ * if there are more
+ */
+static int unique(Engine *e, const Grid g)
+{
+	if (engine_init(e, g) != 0)
+	{
+		return -1;
+	}
+	switch (engine_count(e, 2))
+	{
+	case 1:
+		return 0;
+	case 2:
+		return -2;
+	default:
+		return -1;
+	}
+}
+
+/* Without the clue, the solution stays unique if no solution has
+ * another value in its cell. That search only has to find one
+ * solution, or prove there is none, which is faster than counting to 2.
+ * Each clue needs its own engine_init(): the state of the whole puzzle
+ * was propagated with the clue, which cannot be taken back out of it.
+ */
+static int removable(Engine *e, Grid g, unsigned cell_no)
+{
+	unsigned val = g[cell_no];
+	int ret;
+
+	g[cell_no] = 0;
+	ret = engine_init(e, g) != 0 || engine_exclude(e, cell_no, val) != 0 ||
+		engine_count(e, 1) == 0;
+	g[cell_no] = (unsigned char)val;
+	return ret;
+}
+
+/* The clues are checked one after another, although the checks do not
+ * depend on each other: in batch mode, each worker thread already
+ * checks a puzzle of its own.
+ */
+int minimal_check(Engine *e, const Grid g)
+{
+	Grid work;
+	unsigned i;
+	int n;
+
+	if ((n = unique(e, g)) < 0)
+	{
+		return n;
+	}
+	memcpy(work, g, sizeof(work));
+	for (i = 0; i < GRID_CELLS; i++)
+	{
+		if (work[i] && removable(e, work, i))
+		{
+			n++;
+		}
+	}
+	return n;
+}
+
+/* A clue that is needed stays needed when other clues are removed, as
+ * that only allows more solutions. So one pass is enough.
+ */
+int minimal_reduce(Engine *e, Grid g)
+{
+	unsigned i;
+	int n;
+
+	if ((n = unique(e, g)) < 0)
+	{
+		return n;
+	}
+	for (i = 0; i < GRID_CELLS; i++)
+	{
+		if (g[i] && removable(e, g, i))
+		{
+			g[i] = 0;
+			n++;
+		}
+	}
+	return n;
+}
@@ -0,0 +1,27 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright (c) 2023 Rainer Holzner <rholzner@web.de> */
+
+#ifndef _MINIMAL_H_
+#define _MINIMAL_H_
+
+#include "grid.h"
+#include "engine.h"
+
+/* A puzzle is minimal if its solution is unique and no clue can be
+ * removed without losing that.
+ */
+
+/* Returns the number of clues of g that could be removed one at a time,
+ * 0 if g is minimal, -1 if g has no solution or -2 if it has more than
+ * one.
+ */
+int minimal_check(Engine *e, const Grid g);
+
+/* Removes clues from g in cell order while the solution stays unique,
+ * which leaves a minimal puzzle.
+ * Returns the number of clues removed, or like minimal_check() -1 or -2
+ * if the solution is not unique (g is unchanged then).
+ */
+int minimal_reduce(Engine *e, Grid g);
+
+#endif
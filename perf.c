@@ -0,0 +1,160 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright (c) 2023 Rainer Holzner <rholzner@web.de> */
+
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include "perf.h"
+
+#ifdef __linux__
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+const char *perf_counter_names[PC_NUM] =
+{
+	"cycles", "instructions", "branch-misses", "L1d-misses", "LLC-misses"
+};
+
+#ifdef __linux__
+
+static const struct
+{
+	uint32_t type;
+	uint64_t config;
+} perf_events[PC_NUM] =
+{
+	{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+	{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+	{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+	{ PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D |
+		(PERF_COUNT_HW_CACHE_OP_READ << 8) |
+		(PERF_COUNT_HW_CACHE_RESULT_MISS << 16) },
+	{ PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_LL |
+		(PERF_COUNT_HW_CACHE_OP_READ << 8) |
+		(PERF_COUNT_HW_CACHE_RESULT_MISS << 16) }
+};
+
+int perf_open(Perf *p)
+{
+	struct perf_event_attr attr;
+	int i, num = 0, err = 0;
+
+	for (i = 0; i < PC_NUM; i++)
+	{
+		memset(&attr, 0, sizeof(attr));
+		attr.size = sizeof(attr);
+		attr.type = perf_events[i].type;
+		attr.config = perf_events[i].config;
+		attr.disabled = 1;
+		attr.inherit = 1;
+		/* Allowed with perf_event_paranoid <= 2 */
+		attr.exclude_kernel = 1;
+		attr.exclude_hv = 1;
+		/* For scaling if the PMU has to multiplex the counters */
+		attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED |
+			PERF_FORMAT_TOTAL_TIME_RUNNING;
+		p->fd[i] = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+		p->valid[i] = false;
+		p->value[i] = 0;
+		if (p->fd[i] >= 0)
+		{
+			num++;
+		}
+		else if (err == 0)
+		{
+			err = errno;
+		}
+	}
+	if (num == 0)
+	{
+		errno = err;
+	}
+	return num;
+}
+
+void perf_start(Perf *p)
+{
+	int i;
+
+	for (i = 0; i < PC_NUM; i++)
+	{
+		if (p->fd[i] >= 0)
+		{
+			ioctl(p->fd[i], PERF_EVENT_IOC_RESET, 0);
+			ioctl(p->fd[i], PERF_EVENT_IOC_ENABLE, 0);
+		}
+	}
+}
+
+void perf_stop(Perf *p)
+{
+	/* value, time enabled, time running */
+	uint64_t buf[3];
+	int i;
+
+	for (i = 0; i < PC_NUM; i++)
+	{
+		p->valid[i] = false;
+		if (p->fd[i] < 0)
+		{
+			continue;
+		}
+		ioctl(p->fd[i], PERF_EVENT_IOC_DISABLE, 0);
+		if (read(p->fd[i], buf, sizeof(buf)) == sizeof(buf) && buf[2] > 0)
+		{
+			p->value[i] = (buf[2] < buf[1]) ?
+				(uint64_t)((double)buf[0] * (double)buf[1] / (double)buf[2]) :
+				buf[0];
+			p->valid[i] = true;
+		}
+	}
+}
+
+void perf_close(Perf *p)
+{
+	int i;
+
+	for (i = 0; i < PC_NUM; i++)
+	{
+		if (p->fd[i] >= 0)
+		{
+			close(p->fd[i]);
+			p->fd[i] = -1;
+		}
+	}
+}
+
+#else
+
+int perf_open(Perf *p)
+{
+	int i;
+
+	for (i = 0; i < PC_NUM; i++)
+	{
+		p->fd[i] = -1;
+		p->valid[i] = false;
+	}
+	errno = ENOSYS;
+	return 0;
+}
+
+void perf_start(Perf *p)
+{
+	(void)p;
+}
+
+void perf_stop(Perf *p)
+{
+	(void)p;
+}
+
+void perf_close(Perf *p)
+{
+	(void)p;
+}
+
+#endif
@@ -0,0 +1,43 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright (c) 2023 Rainer Holzner <rholzner@web.de> */
+
+#ifndef _PERF_H_
+#define _PERF_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef enum _perf_counter
+{
+	PC_CYCLES,
+	PC_INSTRUCTIONS,
+	PC_BRANCH_MISSES,
+	PC_L1D_MISSES,
+	PC_LLC_MISSES,
+	PC_NUM
+} Perf_Counter;
+
+/* Hardware performance counters of the calling process.
+ * Threads created after perf_open() are counted too.
+ */
+typedef struct _perf
+{
+	int fd[PC_NUM];
+	uint64_t value[PC_NUM];
+	/* Set for each counter that could be opened and read */
+	bool valid[PC_NUM];
+} Perf;
+
+extern const char *perf_counter_names[PC_NUM];
+
+/* Opens all counters that are available, they start disabled.
+ * Returns the number of counters opened. If it is 0, errno tells why.
+ */
+int perf_open(Perf *p);
+/* Resets and enables the counters */
+void perf_start(Perf *p);
+/* Disables the counters and reads their values */
+void perf_stop(Perf *p);
+void perf_close(Perf *p);
+
+#endif
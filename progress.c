@@ -0,0 +1,78 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright (c) 2023 Rainer Holzner <rholzner@web.de> */
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "progress.h"
+
+static void *progress_main(void *arg)
+{
+	Progress *p = arg;
+	struct timespec timeout = { .tv_sec = (time_t)p->interval };
+	sigset_t set;
+	int sig;
+
+	sigemptyset(&set);
+	sigaddset(&set, SIGUSR1);
+	for (;;)
+	{
+		sig = p->interval ? sigtimedwait(&set, NULL, &timeout) :
+			sigwaitinfo(&set, NULL);
+		/* progress_stop() wakes the thread with SIGUSR1, too */
+		if (atomic_load(&p->done))
+		{
+			break;
+		}
+		if (sig == SIGUSR1 || (sig == -1 && errno == EAGAIN))
+		{
+			p->report(p->arg);
+		}
+	}
+	return NULL;
+}
+
+int progress_start(Progress *p, unsigned interval, Progress_Report report,
+		void *arg)
+{
+	sigset_t set, old;
+	int err;
+
+	p->interval = interval;
+	p->report = report;
+	p->arg = arg;
+	atomic_init(&p->done, false);
+	p->running = false;
+
+	sigemptyset(&set);
+	sigaddset(&set, SIGUSR1);
+	if ((err = pthread_sigmask(SIG_BLOCK, &set, &old)) != 0)
+	{
+		fprintf(stderr, "pthread_sigmask: %s\n", strerror(err));
+		return -1;
+	}
+	if ((err = pthread_create(&p->thread, NULL, progress_main, p)) != 0)
+	{
+		fprintf(stderr, "pthread_create: %s\n", strerror(err));
+		pthread_sigmask(SIG_SETMASK, &old, NULL);
+		return -1;
+	}
+	p->running = true;
+	return 0;
+}
+
+void progress_stop(Progress *p)
+{
+	if (!p->running)
+	{
+		return;
+	}
+	atomic_store(&p->done, true);
+	pthread_kill(p->thread, SIGUSR1);
+	pthread_join(p->thread, NULL);
+	p->running = false;
+}
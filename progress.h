@@ -0,0 +1,40 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright (c) 2023 Rainer Holzner <rholzner@web.de> */
+
+#ifndef _PROGRESS_H_
+#define _PROGRESS_H_
+
+#include <stdbool.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+/* Prints the progress to stderr. It runs in a thread of its own, so it
+ * may only read what the workers publish with atomics.
+ */
+typedef void (*Progress_Report)(void *arg);
+
+typedef struct _progress
+{
+	pthread_t thread;
+	/* Seconds between two reports, 0 means only on SIGUSR1 */
+	unsigned interval;
+	Progress_Report report;
+	void *arg;
+	atomic_bool done;
+	bool running;
+} Progress;
+
+/* Starts a thread that calls report whenever the process receives
+ * SIGUSR1, and every interval seconds if interval is not 0.
+ * Call it before any other thread is created: SIGUSR1 is blocked in the
+ * calling thread, and the threads created later inherit that, so that
+ * only the reporting thread takes the signal.
+ * Returns 0 on success, else -1.
+ */
+int progress_start(Progress *p, unsigned interval, Progress_Report report,
+		void *arg);
+
+/* Stops the thread, without a last report */
+void progress_stop(Progress *p);
+
+#endif
@@ -0,0 +1,125 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright (c) 2023 Rainer Holzner <rholzner@web.de> */
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include "grid.h"
+#include "record.h"
+
+const char record_csv_header[] =
+	"index,puzzle,solution,status,count,nodes,iterations,ns\n";
+
+int record_parse_format(const char *str, Batch_Format *format)
+{
+	if (strcmp(str, "text") == 0)
+		*format = BF_TEXT;
+	else if (strcmp(str, "jsonl") == 0)
+		*format = BF_JSONL;
+	else if (strcmp(str, "csv") == 0)
+		*format = BF_CSV;
+	else
+		return -1;
+	return 0;
+}
+
+/* The put functions append to p and return the new end. None of the
+ * strings needs quoting: grids are digits and dots, and the status is a
+ * plain word.
+ */
+static char *put_str(char *p, const char *s)
+{
+	while (*s)
+	{
+		*p++ = *s++;
+	}
+	return p;
+}
+
+static char *put_u64(char *p, uint64_t v)
+{
+	char digits[20];
+	size_t n = 0;
+
+	do
+	{
+		digits[n++] = (char)('0' + v % 10);
+		v /= 10;
+	} while (v);
+	while (n > 0)
+	{
+		*p++ = digits[--n];
+	}
+	return p;
+}
+
+static char *put_grid(char *p, const unsigned char *g, bool quoted)
+{
+	if (quoted)
+		*p++ = '"';
+	grid_format(g, p);
+	p += GRID_LINE_LEN;
+	if (quoted)
+		*p++ = '"';
+	return p;
+}
+
+static size_t format_jsonl(char *buf, const Record *r)
+{
+	char *p = buf;
+
+	p = put_u64(put_str(p, "{\"index\":"), r->index);
+	p = put_str(p, ",\"puzzle\":");
+	p = r->puzzle ? put_grid(p, r->puzzle, true) : put_str(p, "null");
+	p = put_str(p, ",\"solution\":");
+	p = r->solution ? put_grid(p, r->solution, true) : put_str(p, "null");
+	p = put_str(put_str(p, ",\"status\":\""), r->status);
+	if (r->count >= 0)
+	{
+		p = put_u64(put_str(p, "\",\"count\":"), (uint64_t)r->count);
+		p = put_u64(put_str(p, ",\"nodes\":"), (uint64_t)r->nodes);
+		p = put_str(p, ",\"iterations\":");
+	}
+	else
+	{
+		p = put_str(p, "\",\"iterations\":");
+	}
+	p = put_u64(p, r->iterations);
+	p = put_u64(put_str(p, ",\"ns\":"), r->ns);
+	p = put_str(p, "}\n");
+	return (size_t)(p - buf);
+}
+
+/* Empty fields stand for null */
+static size_t format_csv(char *buf, const Record *r)
+{
+	char *p = buf;
+
+	p = put_u64(p, r->index);
+	*p++ = ',';
+	if (r->puzzle)
+		p = put_grid(p, r->puzzle, false);
+	*p++ = ',';
+	if (r->solution)
+		p = put_grid(p, r->solution, false);
+	*p++ = ',';
+	p = put_str(p, r->status);
+	*p++ = ',';
+	if (r->count >= 0)
+		p = put_u64(p, (uint64_t)r->count);
+	*p++ = ',';
+	if (r->nodes >= 0)
+		p = put_u64(p, (uint64_t)r->nodes);
+	*p++ = ',';
+	p = put_u64(p, r->iterations);
+	*p++ = ',';
+	p = put_u64(p, r->ns);
+	*p++ = '\n';
+	return (size_t)(p - buf);
+}
+
+size_t record_format(char *buf, Batch_Format format, const Record *r)
+{
+	return (format == BF_CSV) ? format_csv(buf, r) : format_jsonl(buf, r);
+}
@@ -0,0 +1,46 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright (c) 2023 Rainer Holzner <rholzner@web.de> */
+
+#ifndef _RECORD_H_
+#define _RECORD_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include "batch.h"
+
+/* Buffer size for the longest record, including the line end */
+#define RECORD_MAX 384
+
+/* Result of one input line in a structured format */
+typedef struct _record
+{
+	/* Record index, counting input lines from 0 across all files */
+	size_t index;
+	/* NULL if the line does not hold a puzzle */
+	const unsigned char *puzzle;
+	/* NULL if there is none */
+	const unsigned char *solution;
+	const char *status;
+	/* Number of solutions, -1 if they were not counted */
+	int count;
+	/* Nodes of the engine that counted them, -1 if not counted */
+	long long nodes;
+	uint64_t iterations;
+	uint64_t ns;
+} Record;
+
+/* First line of the CSV output, with the line end */
+extern const char record_csv_header[];
+
+/* Parses "text", "jsonl" or "csv".
+ * Returns 0 on success, else -1.
+ */
+int record_parse_format(const char *str, Batch_Format *format);
+
+/* Writes the record in format BF_JSONL or BF_CSV to buf, which must hold
+ * RECORD_MAX characters, as one line with the line end.
+ * Returns the length.
+ */
+size_t record_format(char *buf, Batch_Format format, const Record *r);
+
+#endif
@@ -0,0 +1,319 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright (c) 2023 Rainer Holzner <rholzner@web.de> */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "grid.h"
+#include "search.h"
+
+/* Cell numbers of each unit, and the units of each cell (3 in the
+ * classic Sudoku).
+ * They are shared by all Search instances and never change after
+ * search_setup().
+ */
+static unsigned char units[GRID_MAX_UNITS][9];
+static unsigned char cell_units[GRID_CELLS][GRID_MAX_UNITS];
+static unsigned char num_cell_units[GRID_CELLS];
+
+void search_setup(void)
+{
+	unsigned n, u, i, cell_no;
+
+	n = grid_units(units);
+	memset(num_cell_units, 0, sizeof(num_cell_units));
+	for (u = 0; u < n; u++)
+	{
+		for (i = 0; i < 9; i++)
+		{
+			cell_no = units[u][i];
+			cell_units[cell_no][num_cell_units[cell_no]++] =
+				(unsigned char)u;
+		}
+	}
+}
+
+void search_init(Search *s, const Grid g)
+{
+	unsigned i;
+
+	for (i = 0; i < GRID_CELLS; i++)
+	{
+		s->cells[i].value = g[i];
+		s->cells[i].ct = g[i] ? CT_FIXED : CT_BLANK;
+	}
+	s->cell_no = 0;
+	s->iterations = 0;
+}
+
+void search_get(const Search *s, Grid g)
+{
+	unsigned i;
+
+	for (i = 0; i < GRID_CELLS; i++)
+	{
+		g[i] = (s->cells[i].ct == CT_BLANK) ?
+			0 : (unsigned char)s->cells[i].value;
+	}
+}
+
+static int check_unique(const Search *s, const unsigned char a[])
+{
+	unsigned bits = 0;
+	unsigned mask;
+	unsigned i;
+	const Cell *cl;
+
+	for (i = 0; i < 9; i++)
+	{
+		cl = &s->cells[a[i]];
+		if (cl->ct == CT_VALUE || cl->ct == CT_FIXED)
+		{
+			mask = 1 << cl->value;
+			if (bits & mask)
+			{
+				return 0;
+			}
+			bits |= mask;
+		}
+	}
+	return 1;
+}
+
+static int check_cell(const Search *s, int cell_no)
+{
+	unsigned i;
+
+	for (i = 0; i < num_cell_units[cell_no]; i++)
+	{
+		if (!check_unique(s, units[cell_units[cell_no][i]]))
+		{
+			return 0;
+		}
+	}
+	return 1;
+}
+
+int search_check_all(const Search *s)
+{
+	Grid g;
+
+	search_get(s, g);
+	return grid_check(g) >= 0;
+}
+
+int search_forward(Search *s, int cell_no)
+{
+	Cell *cl;
+
+	while (cell_no < 81)
+	{
+		cl = &s->cells[cell_no];
+		if (cl->ct == CT_BLANK)
+		{
+			cl->value = 1;
+			cl->ct = CT_VALUE;
+		}
+		else if (cl->ct == CT_FIXED)
+		{
+			cell_no++;
+			continue;
+		}
+		else
+		{
+			if (cl->value >= 9)
+			{
+				return cell_no;
+			}
+			else
+			{
+				cl->value++;
+			}
+		}
+		while (check_cell(s, cell_no) == 0)
+		{
+			if (cl->value < 9)
+			{
+				cl->value++;
+			}
+			else
+			{
+				/* go back */
+				return cell_no;
+			}
+		}
+		/* go forward */
+		cell_no++;
+	}
+	return cell_no;
+}
+
+int search_back(Search *s, int cell_no)
+{
+	Cell *cl = &s->cells[cell_no];
+
+	/* Set current cell empty */
+	cl->value = 0;
+	cl->ct = CT_BLANK;
+	/* Find cell with (not-fixed) value */
+	while (--cell_no >= 0)
+	{
+		cl = &s->cells[cell_no];
+		if (cl->ct == CT_FIXED)
+		{
+			continue;
+		}
+		else if (cl->ct == CT_VALUE)
+		{
+			break;
+		}
+	}
+	return cell_no;
+}
+
+int search_run(Search *s, size_t budget, Search_Step step)
+{
+	int cell_no = s->cell_no;
+
+	while (cell_no >= 0 && cell_no < 81)
+	{
+		if (budget-- == 0)
+		{
+			s->cell_no = cell_no;
+			return 1;
+		}
+		s->iterations++;
+		cell_no = search_forward(s, cell_no);
+		if (step)
+		{
+			step(s, "forward", cell_no);
+		}
+		if (cell_no >= 0 && cell_no < 81)
+		{
+			cell_no = search_back(s, cell_no);
+			if (step)
+			{
+				step(s, "back", cell_no);
+			}
+		}
+	}
+	s->cell_no = cell_no;
+
+	if (cell_no != 81 || search_check_all(s) == 0)
+	{
+		return -1;
+	}
+	return 0;
+}
+
+int search_solve(Search *s, Search_Step step)
+{
+	return search_run(s, SIZE_MAX, step);
+}
+
+void search_context_init(Search_Context *c)
+{
+	memset(c->clues, 0, sizeof(c->clues));
+	memset(c->solution, 0, sizeof(c->solution));
+	c->result = 1;
+	c->first = false;
+}
+
+/* Returns the first cell that the search has to change, the cell of a
+ * new clue or a cell of its units with the same value in the solution.
+ * The cells before fit the new clues.
+ */
+static unsigned first_change(const Search_Context *c, const Grid g)
+{
+	unsigned i, j, u, k = GRID_CELLS;
+	const unsigned char *unit;
+
+	for (i = 0; i < GRID_CELLS; i++)
+	{
+		if (g[i] == 0 || g[i] == c->solution[i])
+		{
+			continue;
+		}
+		if (i < k)
+		{
+			k = i;
+		}
+		for (u = 0; u < num_cell_units[i]; u++)
+		{
+			unit = units[cell_units[i][u]];
+			for (j = 0; j < 9; j++)
+			{
+				if (c->solution[unit[j]] == g[i] && unit[j] < k)
+				{
+					k = unit[j];
+				}
+			}
+		}
+	}
+	return k;
+}
+
+int search_context_begin(Search_Context *c, const Grid g)
+{
+	Search *s = &c->search;
+	bool added = true, fits = true;
+	unsigned i, k = 0;
+
+	search_init(s, g);
+	if (grid_check(g) < 0)
+	{
+		return -1;
+	}
+	for (i = 0; i < GRID_CELLS; i++)
+	{
+		if (c->clues[i] && g[i] != c->clues[i])
+		{
+			added = false;
+		}
+		if (g[i] && g[i] != c->solution[i])
+		{
+			fits = false;
+		}
+	}
+	memcpy(c->clues, g, sizeof(c->clues));
+	if (c->result == -1 && added)
+	{
+		return -1;
+	}
+	if (c->result == 0 && fits)
+	{
+		/* The first solution of the old clues is the first of the new
+		 * ones too, if it fits them
+		 */
+		c->first = c->first && added;
+		k = GRID_CELLS;
+	}
+	else if (c->result == 0 && c->first && added)
+	{
+		k = first_change(c, g);
+	}
+	else
+	{
+		c->result = 1;
+	}
+	for (i = 0; i < k; i++)
+	{
+		if (s->cells[i].ct == CT_BLANK)
+		{
+			s->cells[i].value = c->solution[i];
+			s->cells[i].ct = CT_VALUE;
+		}
+	}
+	s->cell_no = (int)k;
+	return (k == GRID_CELLS) ? 0 : 1;
+}
+
+void search_context_end(Search_Context *c, int ret)
+{
+	c->result = ret;
+	if (ret == 0)
+	{
+		search_get(&c->search, c->solution);
+		c->first = true;
+	}
+}
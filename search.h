@@ -0,0 +1,108 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright (c) 2023 Rainer Holzner <rholzner@web.de> */
+
+#ifndef _SEARCH_H_
+#define _SEARCH_H_
+
+#include <stddef.h>
+#include <stdbool.h>
+#include "grid.h"
+
+typedef enum _cell_type
+{
+	CT_BLANK,
+	CT_FIXED,
+	CT_VALUE
+} Cell_Type;
+
+typedef struct _cell
+{
+	unsigned value;
+	Cell_Type ct;
+} Cell;
+
+/* State of the forward/back search on one puzzle.
+ * Each thread must use its own instance.
+ */
+typedef struct _search
+{
+	Cell cells[GRID_CELLS];
+	/* Where search_run() continues */
+	int cell_no;
+	/* Number of forward() runs */
+	size_t iterations;
+} Search;
+
+/* Solves one puzzle after the other, where each differs from the one
+ * before in a few clues, like the edits of a setter. The result of the
+ * previous puzzle is kept and used where it allows:
+ * - If the previous solution fits the new clues, it is the result.
+ * - If clues were only added, the search goes on from the first cell it
+ *   has to change: every solution of the new clues is one of the old
+ *   clues, and the search had found the first of those in its order.
+ * - Otherwise the search starts over.
+ */
+typedef struct _search_context
+{
+	Search search;
+	/* Of the previous puzzle */
+	Grid clues;
+	Grid solution;
+	/* 0 if solved, -1 if there is no solution, 1 if unknown */
+	int result;
+	/* The solution is the first in search order, not one kept */
+	bool first;
+} Search_Context;
+
+/* Called after each forward() and back() run with its name and
+ * return value.
+ */
+typedef void (*Search_Step)(const Search *s, const char *step, int ret);
+
+/* Builds the unit tables from grid_units().
+ * Must be called once before any other search function.
+ */
+void search_setup(void);
+
+/* Fixed cells are taken from the values of g, all others are blank */
+void search_init(Search *s, const Grid g);
+void search_get(const Search *s, Grid g);
+
+/* Checks the entire puzzle for validity.
+ * Returns 1 if puzzle is valid, else 0.
+ */
+int search_check_all(const Search *s);
+
+/* Return: 81 Reach end, < 81 go back */
+/* Can continue from back */
+int search_forward(Search *s, int cell_no);
+int search_back(Search *s, int cell_no);
+
+/* Runs forward() and back() at most budget times, and continues where
+ * the previous call stopped. step may be NULL.
+ * Returns 0 if a solution was found, -1 if there is none and 1 if the
+ * budget ran out before either was clear.
+ */
+int search_run(Search *s, size_t budget, Search_Step step);
+
+/* Runs forward() and back() until the puzzle is solved or the search
+ * space is exhausted. step may be NULL.
+ * Returns 0 if a solution was found, else -1.
+ */
+int search_solve(Search *s, Search_Step step);
+
+void search_context_init(Search_Context *c);
+
+/* Sets up c->search for the clues g.
+ * Returns 0 if the solution is already known (it is in c->search then),
+ * -1 if g has no solution, or 1 if search_run() on c->search has to
+ * find out.
+ */
+int search_context_begin(Search_Context *c, const Grid g);
+
+/* Keeps the result of search_run() for the next puzzle. A search that
+ * was not finished (ret 1) is forgotten.
+ */
+void search_context_end(Search_Context *c, int ret);
+
+#endif
@@ -2,100 +2,80 @@
 /* Copyright (c) 2023 Rainer Holzner <rholzner@web.de> */
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <limits.h>
+#include <stdint.h>
+#include <getopt.h>
 #include "config.h"
-
-typedef enum _cell_type
-{
-	CT_BLANK,
-	CT_FIXED,
-	CT_VALUE
-} Cell_Type;
-
-typedef struct _cell
+#include "grid.h"
+#include "search.h"
+#include "batch.h"
+#include "trace.h"
+#include "hashdb.h"
+#include "enumerate.h"
+#include "record.h"
+#include "hist.h"
+
+/* Values of options without a short form */
+enum
 {
-	unsigned value;
-	Cell_Type ct;
-} Cell;
-
-#define CL(a) (&cells[a])
-
-static Cell cells[9*9];
-static Cell *rows[9][9];
-static Cell *cols[9][9];
-static Cell *boxes[9][9];
+	OPT_SHARD = 256,
+	OPT_CHECKPOINT,
+	OPT_CHECKPOINT_INTERVAL,
+	OPT_RESUME,
+	OPT_PERF,
+	OPT_TRACE,
+	OPT_TRACE_SAMPLE,
+	OPT_STORE,
+	OPT_VARIANT,
+	OPT_ALL,
+	OPT_LIMIT,
+	OPT_FORMAT,
+	OPT_BUDGET,
+	OPT_COUNT,
+	OPT_PROGRESS_INTERVAL
+};
 
 static const char *argv0;
-
-static unsigned cell_to_box(unsigned cell_no)
-{
-	unsigned box_y, box_x;
-
-	box_y = (cell_no/9)/3;
-	box_x = (cell_no%9)/3;
-	return box_y*3+box_x;
-}
-
-static void init(void)
-{
-	unsigned i, j, box;
-	Cell empty = { .value = 0, .ct = CT_BLANK };
-
-	for (i = 0; i < 9; i++)
-	{
-		for (j = 0; j < 9; j++)
-		{
-			cells[i*9+j] = empty;
-			rows[i][j] = &cells[i*9+j];
-			cols[i][j] = &cells[j*9+i];
-		}
-	}
-
-	for (box = 0; box < 9; box++)
-	{
-		j = 0;
-		for (i = 0; i < 81; i++)
-		{
-			if (cell_to_box(i) == box)
-			{
-				boxes[box][j++] = CL(i);
-			}
-		}
-	}
-}
+/* The trace of the search, if asked for */
+static Trace_Writer trace;
+static int verbose = 0;
 
 /* Reads at most 81 characters from stdin.
  * Digits between [1..9] represent fixed cell values.
  * CR and LF are ignored.
  * All other characters represent empty cells.
- * 
+ *
  * Returns 0 on success, else -1.
  */
-static int read_puzzle(void)
+static int read_puzzle(Grid g)
 {
 	size_t i = 0;
 	int c;
-	Cell *cl = CL(0);
 
 	while (i < 81 && (c = getchar()) != EOF)
 	{
 		if (c > '0' && c <= '9')
 		{
-			cl->value = (unsigned)(c - '0');
-			cl->ct = CT_FIXED;
+			g[i] = (unsigned char)(c - '0');
 		}
 		else if (c == '\n' || c == '\r')
 		{
 			continue;
 		}
-		/* else: the character represents an empty cell */
+		else
+		{
+			/* the character represents an empty cell */
+			g[i] = 0;
+		}
 		i++;
-		cl++;
 	}
 
 	return (i == 81) ? 0 : -1;
 }
 
-static void print_cells(void)
+static void print_cells(const Search *s)
 {
 	unsigned x, y;
 
@@ -103,7 +83,7 @@ static void print_cells(void)
 	{
 		for (x = 0; x < 9; x++)
 		{
-			Cell *cl = &cells[y*9+x];
+			const Cell *cl = &s->cells[y*9+x];
 			if (cl->ct == CT_BLANK)
 			{
 				printf(". ");
@@ -117,183 +97,386 @@ static void print_cells(void)
 	}
 }
 
-static int check_unique(const Cell *a[])
+/* Called after each step of the search */
+static void solve_step(const Search *s, const char *step, int ret)
 {
-	unsigned bits = 0;
-	unsigned mask;
-	unsigned i;
-	const Cell *cl;
-
-	for (i = 0; i < 9; i++)
+	if (trace.fp)
 	{
-		cl = a[i];
-		if (cl->ct == CT_VALUE || cl->ct == CT_FIXED)
-		{
-			mask = 1 << cl->value;
-			if (bits & mask)
-			{
-				return 0;
-			}
-			bits |= mask;
-		}
+		trace_step(&trace, s);
+	}
+	if (verbose)
+	{
+		printf("%s, ret=%d\n", step, ret);
+		print_cells(s);
 	}
-	return 1;
 }
 
-static int check_cell(int cell_no)
+static int parse_size(const char *str, size_t *value)
 {
-	return check_unique((const Cell **)rows[cell_no/9]) &&
-		check_unique((const Cell **)cols[cell_no%9]) &&
-		check_unique((const Cell **)boxes[cell_to_box(cell_no)]);
+	char *end;
+	unsigned long long v;
+
+	if (str[0] < '0' || str[0] > '9')
+	{
+		return -1;
+	}
+	errno = 0;
+	v = strtoull(str, &end, 10);
+	if (*end != '\0' || errno == ERANGE || v > SIZE_MAX)
+	{
+		return -1;
+	}
+	*value = (size_t)v;
+	return 0;
 }
 
-/* Checks the entire puzzle for validity.
- * Returns 1 if puzzle is valid, else 0.
+/* Parses "K/N" with 1 <= K <= N.
+ * shard is set to K-1 (counting from 0).
  */
-static int check_all(void)
+static int parse_shard(const char *str, size_t *shard, size_t *num_shards)
 {
-	unsigned cell_no;
+	char *end;
+	unsigned long long k, n;
 
-	for (cell_no = 0; cell_no < 81; cell_no++)
+	if (str[0] < '0' || str[0] > '9')
 	{
-		if (check_cell(cell_no) == 0)
-		{
-			return 0;
-		}
+		return -1;
+	}
+	k = strtoull(str, &end, 10);
+	if (*end != '/' || end[1] < '0' || end[1] > '9')
+	{
+		return -1;
+	}
+	n = strtoull(end + 1, &end, 10);
+	if (*end != '\0' || k < 1 || k > n)
+	{
+		return -1;
 	}
-	return 1;
+	*shard = (size_t)(k - 1);
+	*num_shards = (size_t)n;
+	return 0;
 }
 
-/* Return: 81 Reach end, < 81 go back */
-/* Can continue from back */
-static int forward(int cell_no)
+static void usage(void)
 {
-	Cell *cl;
+	fprintf(stderr, "usage: %s [-v] [--variant file] [--store file] "
+			"[--trace file [--trace-sample n]]\n"
+			"       %s --all [--limit n] [-s] [-j threads] "
+			"[--variant file] [--progress-interval sec]\n"
+			"       %s -c|-b|-B|-r|-m [-s] [-j threads] [-n num] "
+			"[--shard K/N] [--perf]\n"
+			"             [--variant file] [--store file] "
+			"[--format text|jsonl|csv]\n"
+			"             [--budget n] [--count [--limit n]] "
+			"[--progress-interval sec]\n"
+			"             [-o file] [--checkpoint file "
+			"[--checkpoint-interval sec] [--resume]] [file...]\n",
+			argv0, argv0, argv0);
+}
 
-	while (cell_no < 81)
+int main(int argc, char *argv[])
+{
+	static const struct option long_options[] =
 	{
-		cl = &cells[cell_no];
-		if (cl->ct == CT_BLANK)
-		{
-			cl->value = 1;
-			cl->ct = CT_VALUE;
-		}
-		else if (cl->ct == CT_FIXED)
-		{
-			cell_no++;
-			continue;
-		}
-		else
+		{ "all", no_argument, NULL, OPT_ALL },
+		{ "batch", no_argument, NULL, 'b' },
+		{ "bench", no_argument, NULL, 'B' },
+		{ "budget", required_argument, NULL, OPT_BUDGET },
+		{ "check", no_argument, NULL, 'c' },
+		{ "checkpoint", required_argument, NULL, OPT_CHECKPOINT },
+		{ "checkpoint-interval", required_argument, NULL,
+			OPT_CHECKPOINT_INTERVAL },
+		{ "count", no_argument, NULL, OPT_COUNT },
+		{ "format", required_argument, NULL, OPT_FORMAT },
+		{ "limit", required_argument, NULL, OPT_LIMIT },
+		{ "minimal", no_argument, NULL, 'm' },
+		{ "output", required_argument, NULL, 'o' },
+		{ "perf", no_argument, NULL, OPT_PERF },
+		{ "progress-interval", required_argument, NULL,
+			OPT_PROGRESS_INTERVAL },
+		{ "reduce", no_argument, NULL, 'r' },
+		{ "resume", no_argument, NULL, OPT_RESUME },
+		{ "shard", required_argument, NULL, OPT_SHARD },
+		{ "slowest", required_argument, NULL, 'n' },
+		{ "stats", no_argument, NULL, 's' },
+		{ "store", required_argument, NULL, OPT_STORE },
+		{ "threads", required_argument, NULL, 'j' },
+		{ "trace", required_argument, NULL, OPT_TRACE },
+		{ "trace-sample", required_argument, NULL, OPT_TRACE_SAMPLE },
+		{ "variant", required_argument, NULL, OPT_VARIANT },
+		{ "verbose", no_argument, NULL, 'v' },
+		{ NULL, 0, NULL, 0 }
+	};
+	Batch_Options bopt =
+	{
+		.mode = BM_SOLVE,
+		.threads = 1,
+		.slowest = 10,
+		.checkpoint_interval = 60
+	};
+	Search search;
+	Grid g, solution;
+	Hashdb db;
+	Hashdb_Result found;
+	const char *trace_path = NULL, *variant = NULL;
+	size_t trace_sample = 1, limit = 0;
+	int batch = 0, all = 0, count = 0;
+	size_t interval, line_no;
+	int opt, ret;
+
+	argv0 = argv[0];
+	while ((opt = getopt_long(argc, argv, "bBcj:mn:o:rsv", long_options,
+			NULL)) != -1)
+	{
+		switch (opt)
 		{
-			if (cl->value >= 9)
+		case 'b':
+			batch = 1;
+			break;
+		case 'B':
+			batch = 1;
+			bopt.quiet = true;
+			bopt.stats = true;
+			break;
+		case 'c':
+			batch = 1;
+			bopt.mode = BM_CHECK;
+			break;
+		case 'r':
+			batch = 1;
+			bopt.mode = BM_REDUCE;
+			break;
+		case 'm':
+			batch = 1;
+			bopt.mode = BM_MINIMAL;
+			break;
+		case 'j':
+			if (parse_size(optarg, &bopt.threads) < 0)
 			{
-				return cell_no;
+				usage();
+				return 1;
 			}
-			else
+			break;
+		case 'n':
+			if (parse_size(optarg, &bopt.slowest) < 0)
 			{
-				cl->value++;
+				usage();
+				return 1;
 			}
-		}
-		while (check_cell(cell_no) == 0)
-		{
-			if (cl->value < 9)
+			if (bopt.slowest > SLOWEST_MAX)
 			{
-				cl->value++;
+				fprintf(stderr, "%s: Error: -n must be at most %d!\n",
+						argv0, SLOWEST_MAX);
+				return 1;
 			}
-			else
+			break;
+		case 'o':
+			bopt.output = optarg;
+			break;
+		case 's':
+			bopt.stats = true;
+			break;
+		case OPT_CHECKPOINT:
+			bopt.checkpoint = optarg;
+			break;
+		case OPT_CHECKPOINT_INTERVAL:
+			if (parse_size(optarg, &interval) < 0 || interval > UINT_MAX)
+			{
+				usage();
+				return 1;
+			}
+			bopt.checkpoint_interval = (unsigned)interval;
+			break;
+		case OPT_RESUME:
+			bopt.resume = true;
+			break;
+		case OPT_PERF:
+			bopt.perf = true;
+			break;
+		case OPT_SHARD:
+			if (parse_shard(optarg, &bopt.shard, &bopt.num_shards) < 0)
 			{
-				/* go back */
-				return cell_no;
+				usage();
+				return 1;
 			}
+			break;
+		case OPT_STORE:
+			bopt.store = optarg;
+			break;
+		case OPT_TRACE:
+			trace_path = optarg;
+			break;
+		case OPT_TRACE_SAMPLE:
+			if (parse_size(optarg, &trace_sample) < 0 || trace_sample == 0)
+			{
+				usage();
+				return 1;
+			}
+			break;
+		case OPT_ALL:
+			all = 1;
+			break;
+		case OPT_LIMIT:
+			if (parse_size(optarg, &limit) < 0)
+			{
+				usage();
+				return 1;
+			}
+			break;
+		case OPT_VARIANT:
+			variant = optarg;
+			break;
+		case OPT_FORMAT:
+			if (record_parse_format(optarg, &bopt.format) < 0)
+			{
+				usage();
+				return 1;
+			}
+			break;
+		case OPT_BUDGET:
+			if (parse_size(optarg, &bopt.budget) < 0)
+			{
+				usage();
+				return 1;
+			}
+			break;
+		case OPT_COUNT:
+			count = 1;
+			break;
+		case OPT_PROGRESS_INTERVAL:
+			if (parse_size(optarg, &interval) < 0 || interval > UINT_MAX)
+			{
+				usage();
+				return 1;
+			}
+			bopt.progress_interval = (unsigned)interval;
+			break;
+		case 'v':
+			verbose = 1;
+			break;
+		default:
+			usage();
+			return 1;
 		}
-		/* go forward */
-		cell_no++;
 	}
-	return cell_no;
-}
-
-static int back(int cell_no)
-{
-	Cell *cl = &cells[cell_no];
 
-	/* Set current cell empty */
-	cl->value = 0;
-	cl->ct = CT_BLANK;
-	/* Find cell with (not-fixed) value */
-	while (--cell_no >= 0)
+	if (variant)
 	{
-		cl = &cells[cell_no];
-		if (cl->ct == CT_FIXED)
+		/* The store does not know the rules its puzzles were solved with */
+		if (bopt.store)
 		{
-			continue;
+			fprintf(stderr, "%s: Error: --store cannot be used with "
+					"--variant!\n", argv0);
+			return 1;
 		}
-		else if (cl->ct == CT_VALUE)
+		if (grid_load_variant(variant, &line_no) != 0)
 		{
-			break;
+			if (errno == EINVAL)
+				fprintf(stderr, "%s:%zu: Error: Invalid region "
+						"description!\n", variant, line_no);
+			else
+				perror(variant);
+			return 1;
 		}
 	}
-	return cell_no;
-}
 
-int main(int argc, char *argv[])
-{
-	int cell_no = 0;
-	int i = 0;
-	int verbose = 0;
-
-	argv0 = argv[0];
-	if (argc == 2 && argv[1][0] == '-' && argv[1][1] == 'v')
+	if ((all && batch) || (limit && !all && !count) ||
+			(count && !batch) ||
+			(bopt.progress_interval && !batch && !all))
+	{
+		usage();
+		return 1;
+	}
+	if (count)
 	{
-		verbose = 1;
+		/* To tell whether the solution is unique */
+		bopt.count = (limit == 0) ? 2 : (limit > INT_MAX) ? INT_MAX :
+			(int)limit;
+	}
+	if (batch)
+	{
+		if ((bopt.resume && !bopt.checkpoint) ||
+				(bopt.checkpoint && !bopt.quiet && !bopt.output))
+		{
+			fprintf(stderr, "%s: Error: --resume needs --checkpoint, "
+					"--checkpoint needs -o!\n", argv0);
+			return 1;
+		}
+		return batch_run(&bopt, argv + optind, argc - optind);
+	}
+	if (optind != argc)
+	{
+		usage();
+		return 1;
 	}
 
-	init();
-	if (read_puzzle() < 0)
+	search_setup();
+	if (read_puzzle(g) < 0)
 	{
 		fprintf(stderr, "%s: Error: Cannot read puzzle data!\n", argv0);
 		return 1;
 	}
+	search_init(&search, g);
 
 	/* Pre-check */
-	cell_no = check_all();
-	if (cell_no != 1)
+	if (search_check_all(&search) != 1)
 	{
 		fprintf(stderr, "%s: Error: The puzzle is invalid!\n", argv0);
 		return 2;
 	}
+	if (all)
+	{
+		return enumerate_run(g, bopt.threads, limit, bopt.stats,
+				bopt.progress_interval);
+	}
 
-	if (verbose)
-		print_cells();
-   
-	cell_no = 0;
-	do
+	if (bopt.store)
 	{
-		i++;
-		cell_no = forward(cell_no);
-		if (verbose)
+		if (hashdb_open(&db, bopt.store, false) != 0)
 		{
-			printf("forward, ret=%d\n", cell_no);
-			print_cells();
+			perror(bopt.store);
+			return 1;
 		}
-		if (cell_no >= 0 && cell_no < 81)
+		found = hashdb_get(&db, g, solution);
+		hashdb_close(&db);
+		if (found == HR_UNSOLVABLE)
 		{
-			cell_no = back(cell_no);
-			if (verbose)
-			{
-				printf("back, ret=%d\n", cell_no);
-				print_cells();
-			}
+			fprintf(stderr, "%s: Error: No solution found!\n", argv0);
+			return 3;
+		}
+		if (found == HR_SOLVED)
+		{
+			/* No search needed */
+			search_init(&search, solution);
+			printf("i=0\n");
+			print_cells(&search);
+			return 0;
 		}
 	}
-	while (cell_no >= 0 && cell_no < 81);
 
-	if (cell_no != 81 || check_all() == 0)
+	if (verbose)
+		print_cells(&search);
+
+	if (trace_path && trace_create(&trace, trace_path, g, trace_sample) != 0)
+	{
+		fprintf(stderr, "%s: Error: Cannot create file `%s'!\n", argv0,
+				trace_path);
+		return 1;
+	}
+	ret = search_solve(&search, (verbose || trace_path) ? solve_step : NULL);
+	if (trace_path && trace_close(&trace, &search) != 0)
+	{
+		fprintf(stderr, "%s: Error: Cannot write file `%s'!\n", argv0,
+				trace_path);
+		return 1;
+	}
+	if (ret != 0)
 	{
 		fprintf(stderr, "%s: Error: No solution found!\n", argv0);
 		return 3;
 	}
 
-	printf("i=%d\n", i);
-	print_cells();
+	printf("i=%zu\n", search.iterations);
+	print_cells(&search);
 	return 0;
 }
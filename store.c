@@ -0,0 +1,365 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright (c) 2023 Rainer Holzner <rholzner@web.de> */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <getopt.h>
+#include "grid.h"
+#include "engine.h"
+#include "hashdb.h"
+
+/* Puzzles a new store is sized for, if not given */
+#define STORE_DEFAULT_NUM 100000
+
+typedef struct _counts
+{
+	size_t added, present, found, unknown, not_unique, invalid;
+} Counts;
+
+typedef int (*Line_Func)(Hashdb *db, const char *path, const Grid g,
+		bool valid, Counts *c);
+
+static const char *argv0;
+/* Only one instance, it is too large for the stack */
+static Engine engine;
+
+static void usage(void)
+{
+	fprintf(stderr, "usage: %s create [-n num] store\n"
+			"       %s add store [file...]\n"
+			"       %s get store [file...]\n"
+			"       %s compact [-n slots] store\n"
+			"       %s stat store\n",
+			argv0, argv0, argv0, argv0, argv0);
+}
+
+static int parse_size(const char *str, size_t *value)
+{
+	char *end;
+	unsigned long long v;
+
+	if (str[0] < '0' || str[0] > '9')
+	{
+		return -1;
+	}
+	errno = 0;
+	v = strtoull(str, &end, 10);
+	if (*end != '\0' || errno == ERANGE || v > SIZE_MAX)
+	{
+		return -1;
+	}
+	*value = (size_t)v;
+	return 0;
+}
+
+/* Calls func for each line of the files, or stdin if there are none.
+ * Returns 0 on success, 1 on I/O errors and -1 if func failed.
+ */
+static int for_each_line(char *files[], int num_files, Line_Func func,
+		Hashdb *db, const char *path, Counts *c)
+{
+	char *line = NULL;
+	size_t size = 0;
+	ssize_t len;
+	FILE *fp;
+	Grid g;
+	int i, ret = 0;
+	bool valid;
+
+	for (i = 0; i < num_files || (i == 0 && num_files == 0); i++)
+	{
+		fp = num_files ? fopen(files[i], "r") : stdin;
+		if (fp == NULL)
+		{
+			perror(files[i]);
+			ret = 1;
+			break;
+		}
+		while (ret == 0 && (len = getline(&line, &size, fp)) != -1)
+		{
+			valid = grid_parse(g, line, (size_t)len) == 0 &&
+				grid_check(g) >= 0;
+			if (func(db, path, g, valid, c) != 0)
+			{
+				ret = -1;
+			}
+		}
+		if (ferror(fp))
+		{
+			perror(num_files ? files[i] : "stdin");
+			ret = 1;
+		}
+		if (fp != stdin)
+		{
+			fclose(fp);
+		}
+		if (ret != 0)
+		{
+			break;
+		}
+	}
+	free(line);
+	return ret;
+}
+
+/* Solves a puzzle that is not yet in the store and adds it. Puzzles with
+ * more than one solution are left out: their solution would depend on
+ * the order of the search.
+ */
+static int add_line(Hashdb *db, const char *path, const Grid g, bool valid,
+		Counts *c)
+{
+	Grid solution;
+	Hashdb_Result r;
+	size_t num_slots;
+	int ret;
+
+	if (!valid)
+	{
+		c->invalid++;
+		return 0;
+	}
+	if (hashdb_get(db, g, solution) != HR_NONE)
+	{
+		c->present++;
+		return 0;
+	}
+	r = HR_UNSOLVABLE;
+	if (engine_init(&engine, g) == 0)
+	{
+		switch (engine_count(&engine, 2))
+		{
+		case 1:
+			r = HR_SOLVED;
+			break;
+		case 2:
+			c->not_unique++;
+			return 0;
+		}
+	}
+	while ((ret = hashdb_put(db, g, r, engine.solution)) < 0)
+	{
+		if (errno != ENOSPC)
+		{
+			perror(path);
+			return -1;
+		}
+		/* Full: continue in a copy twice the size */
+		num_slots = db->num_slots * 2;
+		hashdb_close(db);
+		if (hashdb_rebuild(path, num_slots) != 0 ||
+			hashdb_open(db, path, true) != 0)
+		{
+			perror(path);
+			return -1;
+		}
+	}
+	c->added++;
+	return 0;
+}
+
+/* Writes the solution like the batch mode of the solver does */
+static int get_line(Hashdb *db, const char *path, const Grid g, bool valid,
+		Counts *c)
+{
+	char buf[GRID_LINE_LEN + 1];
+	Grid solution;
+
+	(void)path;
+	if (!valid)
+	{
+		c->invalid++;
+		puts("invalid");
+		return 0;
+	}
+	switch (hashdb_get(db, g, solution))
+	{
+	case HR_SOLVED:
+		c->found++;
+		grid_format(solution, buf);
+		buf[GRID_LINE_LEN] = '\0';
+		puts(buf);
+		break;
+	case HR_UNSOLVABLE:
+		c->found++;
+		puts("unsolvable");
+		break;
+	default:
+		c->unknown++;
+		puts("unknown");
+		break;
+	}
+	return 0;
+}
+
+static int cmd_create(int argc, char *argv[])
+{
+	size_t num = STORE_DEFAULT_NUM;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "n:")) != -1)
+	{
+		if (opt != 'n' || parse_size(optarg, &num) < 0)
+		{
+			usage();
+			return 1;
+		}
+	}
+	if (optind + 1 != argc)
+	{
+		usage();
+		return 1;
+	}
+	if (hashdb_create(argv[optind], num) != 0)
+	{
+		perror(argv[optind]);
+		return 1;
+	}
+	return 0;
+}
+
+static int cmd_add(int argc, char *argv[])
+{
+	Counts c = { 0 };
+	Hashdb db;
+	int ret;
+
+	if (argc < 2)
+	{
+		usage();
+		return 1;
+	}
+	if (hashdb_open(&db, argv[1], true) != 0)
+	{
+		perror(argv[1]);
+		return 1;
+	}
+	engine_setup();
+	engine.cancel = NULL;
+	ret = for_each_line(argv + 2, argc - 2, add_line, &db, argv[1], &c);
+	hashdb_close(&db);
+	fprintf(stderr, "added=%zu present=%zu not_unique=%zu invalid=%zu\n",
+			c.added, c.present, c.not_unique, c.invalid);
+	return (ret == 0) ? 0 : 1;
+}
+
+static int cmd_get(int argc, char *argv[])
+{
+	Counts c = { 0 };
+	Hashdb db;
+	int ret;
+
+	if (argc < 2)
+	{
+		usage();
+		return 1;
+	}
+	if (hashdb_open(&db, argv[1], false) != 0)
+	{
+		perror(argv[1]);
+		return 1;
+	}
+	ret = for_each_line(argv + 2, argc - 2, get_line, &db, argv[1], &c);
+	hashdb_close(&db);
+	if (fflush(stdout) == EOF)
+	{
+		perror("fflush");
+		ret = 1;
+	}
+	if (ret != 0)
+		return 1;
+	if (c.invalid)
+		return 2;
+	if (c.unknown)
+		return 3;
+	return 0;
+}
+
+static int cmd_compact(int argc, char *argv[])
+{
+	size_t num_slots = 0;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "n:")) != -1)
+	{
+		if (opt != 'n' || parse_size(optarg, &num_slots) < 0)
+		{
+			usage();
+			return 1;
+		}
+	}
+	if (optind + 1 != argc)
+	{
+		usage();
+		return 1;
+	}
+	if (hashdb_rebuild(argv[optind], num_slots) != 0)
+	{
+		perror(argv[optind]);
+		return 1;
+	}
+	return 0;
+}
+
+static int cmd_stat(int argc, char *argv[])
+{
+	Hashdb db;
+	Hashdb_Stat st;
+
+	if (argc != 2)
+	{
+		usage();
+		return 1;
+	}
+	if (hashdb_open(&db, argv[1], false) != 0)
+	{
+		perror(argv[1]);
+		return 1;
+	}
+	hashdb_stat(&db, &st);
+	printf("slots=%zu entries=%zu load=%.1f%% size=%zu\n"
+			"solved=%zu unsolvable=%zu\n"
+			"probe mean=%.2f max=%zu\n",
+			st.num_slots, st.count, 100.0 * st.count / st.num_slots,
+			db.map_size, st.solved, st.unsolvable, st.mean_probe,
+			st.max_probe);
+	hashdb_close(&db);
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	static const struct
+	{
+		const char *name;
+		int (*func)(int argc, char *argv[]);
+	} commands[] =
+	{
+		{ "create", cmd_create },
+		{ "add", cmd_add },
+		{ "get", cmd_get },
+		{ "compact", cmd_compact },
+		{ "stat", cmd_stat }
+	};
+	size_t i;
+
+	argv0 = argv[0];
+	if (argc < 2)
+	{
+		usage();
+		return 1;
+	}
+	for (i = 0; i < sizeof(commands) / sizeof(commands[0]); i++)
+	{
+		if (strcmp(argv[1], commands[i].name) == 0)
+		{
+			/* The command is argv[0] of its own arguments */
+			return commands[i].func(argc - 1, argv + 1);
+		}
+	}
+	usage();
+	return 1;
+}
@@ -6,10 +6,27 @@
 #include <termios.h>
 #include <errno.h>
 #include <stdbool.h>
+#include <poll.h>
 #include "term.h"
 
+/* Switches bracketed paste on and off */
+#define PASTE_ON "\x1b[?2004h"
+#define PASTE_OFF "\x1b[?2004l"
+/* Pasted text comes between ESC [200~ and ESC [201~ */
+#define PASTE_BEGIN 200
+#define PASTE_END "\x1b[201~"
+#define PASTE_END_LEN (sizeof(PASTE_END) - 1)
+
 static struct termios term_old_settings;
 static bool term_undo_settings;
+/* Bytes read from the terminal but not yet decoded, filled by read() as
+ * much as there is, so that keys that come together are decoded without
+ * a system call each
+ */
+static unsigned char in_buf[256];
+static size_t in_pos, in_len;
+static char paste[TERM_PASTE_MAX];
+static size_t paste_len;
 
 int terminal_init(void)
 {
@@ -33,16 +50,85 @@ int terminal_init(void)
 		perror("tcsetattr");
 	}
 	term_undo_settings = true;
+	fputs(PASTE_ON, stdout);
+	fflush(stdout);
 	return status;
 }
 
+/* Returns the next byte from the terminal, waiting for it if needed */
+static int read_byte(void)
+{
+	ssize_t n;
+
+	if (in_pos == in_len)
+	{
+		in_pos = in_len = 0;
+		n = read(0, in_buf, sizeof(in_buf));
+		if (n <= 0)
+		{
+			return EOF;
+		}
+		in_len = (size_t)n;
+	}
+	return in_buf[in_pos++];
+}
+
+int terminal_key_pending(void)
+{
+	struct pollfd pfd = { .fd = 0, .events = POLLIN };
+
+	return in_pos < in_len || poll(&pfd, 1, 0) > 0;
+}
+
+/* Reads pasted text up to the end sequence.
+ * Returns KEY_PASTE, or EOF.
+ */
+static int read_paste(void)
+{
+	size_t total = 0, matched = 0;
+	int c;
+
+	paste_len = 0;
+	while (matched < PASTE_END_LEN)
+	{
+		if ((c = read_byte()) == EOF)
+		{
+			return EOF;
+		}
+		/* ESC only starts the end sequence within pasted text */
+		if (c == PASTE_END[matched])
+			matched++;
+		else
+			matched = (c == PASTE_END[0]) ? 1 : 0;
+		/* The rest of a longer text is dropped */
+		if (paste_len < sizeof(paste))
+		{
+			paste[paste_len++] = (char)c;
+		}
+		total++;
+	}
+	if (paste_len > total - PASTE_END_LEN)
+	{
+		paste_len = total - PASTE_END_LEN;
+	}
+	return KEY_PASTE;
+}
+
+const char *terminal_paste(size_t *len)
+{
+	*len = paste_len;
+	return paste;
+}
+
 int terminal_read_key(void)
 {
 	enum { S_0, S_ESC, S_CSI, S_SKIP };
 	static int state;
+	/* Numeric parameter of a CSI sequence, -1 if there is another one */
+	static int param;
 	int c;
 
-	while ((c = getchar()) != EOF)
+	while ((c = read_byte()) != EOF)
 	{
 		switch (state)
 		{
@@ -71,11 +157,13 @@ int terminal_read_key(void)
 			{
 				/* optional parameter byte */
 				state = S_SKIP;
+				param = (c <= 0x39) ? c - 0x30 : -1;
 			}
 			else if (c >= 0x20 && c <= 0x2f)
 			{
 				/* optional intermediate bytes */
 				state = S_SKIP;
+				param = -1;
 			}
 			else if (c >= 0x40 && c <= 0x7e)
 			{
@@ -93,9 +181,14 @@ int terminal_read_key(void)
 			}
 			break;
 		case S_SKIP:
-			if (c >= 0x30 && c <= 0x3f)
+			if (c >= 0x30 && c <= 0x39 && param >= 0 && param < 1000)
+			{
+				param = param * 10 + c - 0x30;
+			}
+			else if (c >= 0x30 && c <= 0x3f)
 			{
 				/* optional parameter byte */
+				param = -1;
 			}
 			else if (c >= 0x20 && c <= 0x2f)
 			{
@@ -108,6 +201,10 @@ int terminal_read_key(void)
 			else
 			{
 				state = S_0;
+				if (c == 0x7e && param == PASTE_BEGIN)
+				{
+					return read_paste();
+				}
 			}
 			break;
 		}
@@ -118,10 +215,15 @@ int terminal_read_key(void)
 	}
 	return c;
 }
+
 void terminal_restore(void)
 {
+	/* Like the input that TCSAFLUSH discards */
+	in_pos = in_len = 0;
 	if (term_undo_settings)
 	{
+		fputs(PASTE_OFF, stdout);
+		fflush(stdout);
 		if (tcsetattr(0, TCSAFLUSH, &term_old_settings) == -1)
 		{
 			perror("Failed to restore terminal settings!");
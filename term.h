@@ -4,14 +4,30 @@
 #ifndef _TERM_H_
 #define _TERM_H_
 
+#include <stddef.h>
+
 #define KEY_ARROW_UP    0x1b5b41
 #define KEY_ARROW_DOWN  0x1b5b42
 #define KEY_ARROW_RIGHT 0x1b5b43
 #define KEY_ARROW_LEFT  0x1b5b44
 #define KEY_DEL  		0x7e
+#define KEY_CTRL_L		0x0c
+#define KEY_CTRL_R		0x12
+/* Text pasted with bracketed paste, see terminal_paste(). Above all
+ * codes of escape sequences, so that no sequence decodes to it.
+ */
+#define KEY_PASTE		0x1000000
+
+/* Longer pasted text is cut */
+#define TERM_PASTE_MAX 1024
 
 int terminal_init(void);
+/* Returns the next key, waiting for it if needed, or EOF */
 int terminal_read_key(void);
+/* Returns 1 if a key has been typed that is not read yet, else 0 */
+int terminal_key_pending(void);
+/* Returns the text of the last KEY_PASTE */
+const char *terminal_paste(size_t *len);
 void terminal_restore(void);
 
 #endif
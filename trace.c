@@ -0,0 +1,209 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright (c) 2023 Rainer Holzner <rholzner@web.de> */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "grid.h"
+#include "search.h"
+#include "trace.h"
+
+#define TRACE_MAGIC "sdktrc1"
+
+typedef struct _trace_header
+{
+	char magic[8];
+	uint64_t sample;
+	Grid start;
+} Trace_Header;
+
+/* The events start at the first multiple of 8 after the header */
+#define EVENTS_OFFSET ((sizeof(Trace_Header) + 7) & ~(size_t)7)
+
+static void flush(Trace_Writer *t)
+{
+	if (t->len > 0 && fwrite(t->buf, sizeof(t->buf[0]), t->len, t->fp) !=
+			t->len)
+	{
+		t->error = true;
+	}
+	t->len = 0;
+}
+
+static void put(Trace_Writer *t, uint16_t ev)
+{
+	if (t->len == TRACE_BUF_LEN)
+	{
+		flush(t);
+	}
+	t->buf[t->len++] = ev;
+}
+
+int trace_create(Trace_Writer *t, const char *path, const Grid g,
+		size_t sample)
+{
+	unsigned char header[EVENTS_OFFSET];
+	Trace_Header h;
+
+	memset(t, 0, sizeof(*t));
+	t->sample = sample ? sample : 1;
+	memcpy(t->shown, g, sizeof(t->shown));
+	t->fp = fopen(path, "wb");
+	if (t->fp == NULL)
+	{
+		return -1;
+	}
+	memset(&h, 0, sizeof(h));
+	memcpy(h.magic, TRACE_MAGIC, sizeof(h.magic));
+	h.sample = t->sample;
+	memcpy(h.start, g, sizeof(h.start));
+	memset(header, 0, sizeof(header));
+	memcpy(header, &h, sizeof(h));
+	if (fwrite(header, sizeof(header), 1, t->fp) != 1)
+	{
+		fclose(t->fp);
+		t->fp = NULL;
+		return -1;
+	}
+	return 0;
+}
+
+static void write_frame(Trace_Writer *t, const Search *s)
+{
+	Grid g;
+	unsigned i;
+
+	search_get(s, g);
+	for (i = 0; i < GRID_CELLS; i++)
+	{
+		if (g[i] != t->shown[i])
+		{
+			put(t, TRACE_EVENT(i, g[i]));
+			t->shown[i] = g[i];
+		}
+	}
+	put(t, TRACE_FRAME);
+}
+
+void trace_step(Trace_Writer *t, const Search *s)
+{
+	if (++t->count < t->sample)
+	{
+		return;
+	}
+	t->count = 0;
+	write_frame(t, s);
+}
+
+int trace_close(Trace_Writer *t, const Search *s)
+{
+	int ret;
+
+	/* The last steps may have fallen between two samples */
+	if (t->count > 0)
+	{
+		write_frame(t, s);
+	}
+	flush(t);
+	ret = (fclose(t->fp) == 0 && !t->error) ? 0 : -1;
+	t->fp = NULL;
+	return ret;
+}
+
+int trace_open(Trace *t, const char *path)
+{
+	const Trace_Header *h;
+	struct stat st;
+	void *map;
+	int fd;
+
+	memset(t, 0, sizeof(*t));
+	fd = open(path, O_RDONLY);
+	if (fd == -1)
+	{
+		return -1;
+	}
+	if (fstat(fd, &st) == -1)
+	{
+		close(fd);
+		return -1;
+	}
+	if ((size_t)st.st_size < EVENTS_OFFSET)
+	{
+		close(fd);
+		errno = EINVAL;
+		return -1;
+	}
+	map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED)
+	{
+		return -1;
+	}
+	h = map;
+	if (memcmp(h->magic, TRACE_MAGIC, sizeof(h->magic)) != 0)
+	{
+		munmap(map, st.st_size);
+		errno = EINVAL;
+		return -1;
+	}
+	t->data = map;
+	t->size = st.st_size;
+	/* A trace cut short, e.g. by a killed solver, is replayed as far
+	 * as it goes
+	 */
+	t->events = (const uint16_t *)(t->data + EVENTS_OFFSET);
+	t->num_events = (t->size - EVENTS_OFFSET) / sizeof(uint16_t);
+	t->sample = h->sample;
+	memcpy(t->start, h->start, sizeof(t->start));
+	trace_rewind(t);
+	return 0;
+}
+
+void trace_free(Trace *t)
+{
+	if (t->data)
+	{
+		munmap((void *)t->data, t->size);
+	}
+	memset(t, 0, sizeof(*t));
+}
+
+void trace_rewind(Trace *t)
+{
+	memcpy(t->g, t->start, sizeof(t->g));
+	t->pos = 0;
+	t->frame = 0;
+	t->last_cell = -1;
+}
+
+int trace_next(Trace *t)
+{
+	uint16_t ev;
+
+	if (t->pos >= t->num_events)
+	{
+		return -1;
+	}
+	while (t->pos < t->num_events)
+	{
+		ev = t->events[t->pos++];
+		if (ev == TRACE_FRAME)
+		{
+			break;
+		}
+		if (TRACE_CELL(ev) < GRID_CELLS && TRACE_VALUE(ev) <= 9)
+		{
+			t->g[TRACE_CELL(ev)] = (unsigned char)TRACE_VALUE(ev);
+			t->last_cell = (int)TRACE_CELL(ev);
+		}
+	}
+	t->frame++;
+	return 0;
+}
@@ -0,0 +1,80 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright (c) 2023 Rainer Holzner <rholzner@web.de> */
+
+#ifndef _TRACE_H_
+#define _TRACE_H_
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "grid.h"
+#include "search.h"
+
+/* A trace file is a header with the puzzle followed by 16 bit events, in
+ * the byte order of the machine that wrote it. An event sets a cell to a
+ * value, 0 for blank. A frame, one sampled step of the search, is the
+ * events of the cells that changed since the previous frame, followed by
+ * TRACE_FRAME.
+ */
+#define TRACE_EVENT(cell_no, value) ((uint16_t)((cell_no) << 4 | (value)))
+#define TRACE_CELL(ev) ((unsigned)(ev) >> 4)
+#define TRACE_VALUE(ev) ((unsigned)(ev) & 0xf)
+#define TRACE_FRAME 0xffff
+
+/* Events buffered before they are written */
+#define TRACE_BUF_LEN 4096
+
+typedef struct _trace_writer
+{
+	FILE *fp;
+	/* The grid as of the last frame written */
+	Grid shown;
+	/* A frame is written every sample steps */
+	size_t sample;
+	size_t count;
+	uint16_t buf[TRACE_BUF_LEN];
+	size_t len;
+	bool error;
+} Trace_Writer;
+
+/* Creates the file and writes the header with the puzzle g.
+ * Returns 0 on success, else -1 with errno set.
+ */
+int trace_create(Trace_Writer *t, const char *path, const Grid g,
+		size_t sample);
+/* For each step of the search, writes a frame for every sample-th */
+void trace_step(Trace_Writer *t, const Search *s);
+/* Writes the last state of the search as a frame and closes the file.
+ * Returns 0 on success, else -1.
+ */
+int trace_close(Trace_Writer *t, const Search *s);
+
+/* A trace file mapped into memory for replay */
+typedef struct _trace
+{
+	const unsigned char *data;
+	size_t size;
+	const uint16_t *events;
+	size_t num_events;
+	size_t sample;
+	Grid start;
+	/* State after the frames replayed so far */
+	Grid g;
+	size_t pos;
+	size_t frame;
+	/* Cell changed last, -1 if none */
+	int last_cell;
+} Trace;
+
+/* Returns 0 on success, else -1 with errno set */
+int trace_open(Trace *t, const char *path);
+void trace_free(Trace *t);
+/* Goes back to the puzzle */
+void trace_rewind(Trace *t);
+/* Applies the next frame.
+ * Returns 0 on success, -1 at the end of the trace.
+ */
+int trace_next(Trace *t);
+
+#endif
@@ -0,0 +1,95 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright (c) 2023 Rainer Holzner <rholzner@web.de> */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+#include "track.h"
+
+#define BOX(x, y) (((y)/3)*3 + (x)/3)
+#define ALL_VALUES 0x3fe
+
+/* Updates one counter and its mask.
+ * Returns the change of the number of conflicts.
+ */
+static int count_add(unsigned char *count, unsigned *mask, int val)
+{
+	if (count[val]++ == 0)
+	{
+		*mask |= 1u << val;
+		return 0;
+	}
+	/* The second occurrence makes a conflict, further ones add to it */
+	return (count[val] == 2) ? 1 : 0;
+}
+
+static int count_remove(unsigned char *count, unsigned *mask, int val)
+{
+	if (--count[val] == 0)
+	{
+		*mask &= ~(1u << val);
+		return 0;
+	}
+	return (count[val] == 1) ? -1 : 0;
+}
+
+void track_reset(Track *t)
+{
+	memset(t, 0, sizeof(*t));
+}
+
+void track_load(Track *t, const int cells[9][9])
+{
+	size_t x, y;
+
+	track_reset(t);
+	for (y = 0; y < 9; y++)
+	{
+		for (x = 0; x < 9; x++)
+		{
+			track_add(t, x, y, cells[y][x]);
+		}
+	}
+}
+
+void track_add(Track *t, size_t x, size_t y, int val)
+{
+	size_t b = BOX(x, y);
+
+	if (val <= 0 || val > 9)
+	{
+		return;
+	}
+	t->conflicts += count_add(t->row[y], &t->row_mask[y], val);
+	t->conflicts += count_add(t->col[x], &t->col_mask[x], val);
+	t->conflicts += count_add(t->box[b], &t->box_mask[b], val);
+}
+
+void track_remove(Track *t, size_t x, size_t y, int val)
+{
+	size_t b = BOX(x, y);
+
+	if (val <= 0 || val > 9)
+	{
+		return;
+	}
+	t->conflicts += count_remove(t->row[y], &t->row_mask[y], val);
+	t->conflicts += count_remove(t->col[x], &t->col_mask[x], val);
+	t->conflicts += count_remove(t->box[b], &t->box_mask[b], val);
+}
+
+bool track_conflict(const Track *t, size_t x, size_t y, int val)
+{
+	if (val <= 0 || val > 9)
+	{
+		return false;
+	}
+	return t->row[y][val] > 1 || t->col[x][val] > 1 ||
+		t->box[BOX(x, y)][val] > 1;
+}
+
+unsigned track_candidates(const Track *t, size_t x, size_t y)
+{
+	return ALL_VALUES &
+		~(t->row_mask[y] | t->col_mask[x] | t->box_mask[BOX(x, y)]);
+}
@@ -0,0 +1,38 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright (c) 2023 Rainer Holzner <rholzner@web.de> */
+
+#ifndef _TRACK_H_
+#define _TRACK_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/* Counts how often each value appears in each row, column and box.
+ * Adding or removing a value costs O(1), and so does asking whether a
+ * cell conflicts with another one or which values it can still take.
+ */
+typedef struct _track
+{
+	/* Index 0 is unused, values are 1-9 */
+	unsigned char row[9][10], col[9][10], box[9][10];
+	/* Bit v is set if value v appears at least once */
+	unsigned row_mask[9], col_mask[9], box_mask[9];
+	/* Number of (unit, value) pairs that appear more than once */
+	unsigned conflicts;
+} Track;
+
+void track_reset(Track *t);
+void track_load(Track *t, const int cells[9][9]);
+/* val 0 (blank) is ignored */
+void track_add(Track *t, size_t x, size_t y, int val);
+void track_remove(Track *t, size_t x, size_t y, int val);
+/* Returns true if val at (x, y) appears again in its row, column or
+ * box. The value must have been added.
+ */
+bool track_conflict(const Track *t, size_t x, size_t y, int val);
+/* Returns the values that do not appear in the row, column or box of
+ * (x, y) as bit mask, bit v for value v.
+ */
+unsigned track_candidates(const Track *t, size_t x, size_t y);
+
+#endif
@@ -2,13 +2,36 @@
 /* Copyright (c) 2023 Rainer Holzner <rholzner@web.de> */
 
 #include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
 #include <string.h>
+#include <errno.h>
+#include <unistd.h>
 #include "tui.h"
 
 static Text_Cell tui_frame_buffer[FRAME_SIZE_Y][FRAME_SIZE_X];
 static size_t tui_frame_pos_x, tui_frame_pos_y;
 static size_t tui_frame_size_x, tui_frame_size_y;
 
+/* What is on screen (front) and what should be (back) */
+static Text_Cell tui_front[TUI_SCREEN_Y][TUI_SCREEN_X];
+static Text_Cell tui_back[TUI_SCREEN_Y][TUI_SCREEN_X];
+/* false if the screen was changed behind our back */
+static bool tui_front_valid;
+
+/* Longest escape sequence of out_move() or out_sgr() */
+#define OUT_SEQ_MAX 32
+/* Worst case of a frame: a move, a change of attributes and the
+ * character for every cell, plus the clear before and the reset and the
+ * cursor move after them
+ */
+#define OUT_MAX (TUI_SCREEN_Y * TUI_SCREEN_X * (2 * OUT_SEQ_MAX + 1) + \
+		3 * OUT_SEQ_MAX)
+
+/* Escape sequences of one frame, sent with a single write() */
+static char tui_out[OUT_MAX];
+static size_t tui_out_len;
+
 void cursor_off(void)
 {
 	printf("\x1b[?25l");
@@ -83,6 +106,7 @@ void tui_frame_init(size_t x, size_t y, size_t size_x, size_t size_y)
 void tui_init(void)
 {
 	tui_clear_screen();
+	tui_begin();
 }
 
 void tui_deinit(void)
@@ -94,6 +118,7 @@ void tui_clear_screen(void)
 {
 	move_cursor_home();
 	clear_screen();
+	tui_invalidate();
 }
 
 void tui_frame_clear(void)
@@ -114,21 +139,10 @@ void tui_frame_draw(void)
 {
 	for (size_t y = 0; y < tui_frame_size_y; y++)
 	{
-		set_cursor_pos(tui_frame_pos_x+1, tui_frame_pos_y+y+1);
 		for (size_t x = 0; x < tui_frame_size_x; x++)
 		{
-			const Text_Cell *tc = &tui_frame_buffer[y][x];
-			printf("\033[%d", tc->sty);
-			if (tc->fg != SYS_DEFAULT)
-				printf(";%d", 30 + tc->fg);
-			if (tc->bg != SYS_DEFAULT)
-				printf(";%d", 40 + tc->bg);
-			printf("m%c\033[m", tc->c);
-	//		printf("\033[%d;%d;%dm%c\033[m",
-	//				tc->sty,
-	//				tc->fg == SYS_DEFAULT ? 0 : 30 + tc->fg,
-	//				tc->bg == SYS_DEFAULT ? 0 : 40 + tc->bg,
-	//				tc->c);
+			tui_set(tui_frame_pos_x+x, tui_frame_pos_y+y,
+					&tui_frame_buffer[y][x]);
 		}
 	}
 }
@@ -169,3 +183,216 @@ void tui_frame_fill(Color fg, Color bg, Style sty, const char *txt)
 		}
 	}
 }
+
+static bool same_attr(const Text_Cell *a, const Text_Cell *b)
+{
+	return a->fg == b->fg && a->bg == b->bg && a->sty == b->sty;
+}
+
+static bool same_cell(const Text_Cell *a, const Text_Cell *b)
+{
+	return a->c == b->c && same_attr(a, b);
+}
+
+static void out_flush(void)
+{
+	size_t done = 0;
+	ssize_t n;
+
+	while (done < tui_out_len)
+	{
+		n = write(1, tui_out + done, tui_out_len - done);
+		if (n < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			/* Nothing sensible left to do, the terminal is gone */
+			break;
+		}
+		done += (size_t)n;
+	}
+	tui_out_len = 0;
+}
+
+/* tui_out holds a whole frame, the flush is only a safeguard */
+static void out_put(const char *s, size_t len)
+{
+	if (tui_out_len + len > sizeof(tui_out))
+	{
+		out_flush();
+	}
+	memcpy(tui_out + tui_out_len, s, len);
+	tui_out_len += len;
+}
+
+static void out_sgr(const Text_Cell *tc)
+{
+	char buf[OUT_SEQ_MAX];
+	int len;
+
+	/* 0 resets the previous attributes */
+	len = snprintf(buf, sizeof(buf), "\033[0");
+	if (tc->sty != NORMAL)
+		len += snprintf(buf+len, sizeof(buf)-len, ";%d", tc->sty);
+	if (tc->fg != SYS_DEFAULT)
+		len += snprintf(buf+len, sizeof(buf)-len, ";%d", 30 + tc->fg);
+	if (tc->bg != SYS_DEFAULT)
+		len += snprintf(buf+len, sizeof(buf)-len, ";%d", 40 + tc->bg);
+	buf[len++] = 'm';
+	out_put(buf, len);
+}
+
+/* Moves the cursor from (*cur_x, cur_y) to (x, y) with as few bytes as
+ * possible. A short gap on the same line is bridged by writing the
+ * cells again if that needs no change of attributes.
+ */
+static void out_move(size_t *cur_x, size_t *cur_y, size_t x, size_t y,
+		const Text_Cell *attr)
+{
+	char buf[OUT_SEQ_MAX];
+	int len;
+	size_t i;
+	bool bridge = true;
+
+	if (*cur_y == y && *cur_x == x)
+	{
+		return;
+	}
+	if (*cur_y == y && *cur_x < x)
+	{
+		if (x - *cur_x <= 3)
+		{
+			for (i = *cur_x; i < x; i++)
+			{
+				bridge = bridge && same_attr(&tui_back[y][i], attr);
+			}
+			if (bridge)
+			{
+				for (i = *cur_x; i < x; i++)
+				{
+					out_put(&tui_back[y][i].c, 1);
+				}
+				*cur_x = x;
+				return;
+			}
+		}
+		len = snprintf(buf, sizeof(buf), "\033[%zuC", x - *cur_x);
+	}
+	else
+	{
+		len = snprintf(buf, sizeof(buf), "\033[%zu;%zuH", y+1, x+1);
+	}
+	out_put(buf, len);
+	*cur_x = x;
+	*cur_y = y;
+}
+
+void tui_begin(void)
+{
+	Text_Cell blank;
+
+	tui_text_cell_init(&blank);
+	for (size_t y = 0; y < TUI_SCREEN_Y; y++)
+	{
+		for (size_t x = 0; x < TUI_SCREEN_X; x++)
+		{
+			tui_back[y][x] = blank;
+		}
+	}
+}
+
+int tui_set(size_t x, size_t y, const Text_Cell *tc)
+{
+	if (x >= TUI_SCREEN_X || y >= TUI_SCREEN_Y)
+	{
+		return -1;
+	}
+	tui_back[y][x] = *tc;
+	return 0;
+}
+
+size_t tui_text(size_t x, size_t y, const char *txt,
+		Color fg, Color bg, Style sty)
+{
+	Text_Cell tc = { fg, bg, sty, ' ' };
+	size_t x0 = x;
+
+	for (; *txt != '\0'; txt++)
+	{
+		if (*txt == '\n')
+		{
+			x = x0;
+			y++;
+			continue;
+		}
+		tc.c = *txt;
+		tui_set(x++, y, &tc);
+	}
+	return x;
+}
+
+void tui_invalidate(void)
+{
+	tui_front_valid = false;
+}
+
+void tui_flush(size_t cursor_x, size_t cursor_y)
+{
+	Text_Cell attr;
+	size_t x, y;
+	/* SIZE_MAX: unknown, e.g. after writing the last column */
+	size_t cur_x = SIZE_MAX, cur_y = SIZE_MAX;
+	static const char clear[] = "\033[m\033[H\033[2J";
+
+	/* Anything printed with stdio must come first */
+	fflush(stdout);
+	tui_text_cell_init(&attr);
+	if (!tui_front_valid)
+	{
+		out_put(clear, sizeof(clear)-1);
+		for (y = 0; y < TUI_SCREEN_Y; y++)
+		{
+			for (x = 0; x < TUI_SCREEN_X; x++)
+			{
+				tui_text_cell_init(&tui_front[y][x]);
+			}
+		}
+		cur_x = 0;
+		cur_y = 0;
+		tui_front_valid = true;
+	}
+
+	for (y = 0; y < TUI_SCREEN_Y; y++)
+	{
+		for (x = 0; x < TUI_SCREEN_X; x++)
+		{
+			const Text_Cell *tc = &tui_back[y][x];
+
+			if (same_cell(&tui_front[y][x], tc))
+			{
+				continue;
+			}
+			out_move(&cur_x, &cur_y, x, y, &attr);
+			if (!same_attr(&attr, tc))
+			{
+				out_sgr(tc);
+				attr = *tc;
+			}
+			out_put(&tc->c, 1);
+			tui_front[y][x] = *tc;
+			if (++cur_x == TUI_SCREEN_X)
+			{
+				cur_x = SIZE_MAX;
+				cur_y = SIZE_MAX;
+			}
+		}
+	}
+
+	if (attr.sty != NORMAL || attr.fg != SYS_DEFAULT || attr.bg != SYS_DEFAULT)
+	{
+		out_put("\033[m", 3);
+		tui_text_cell_init(&attr);
+	}
+	out_move(&cur_x, &cur_y, cursor_x, cursor_y, &attr);
+	out_flush();
+}
@@ -4,9 +4,15 @@
 #ifndef _TUI_H_
 #define _TUI_H_
 
+#include <stddef.h>
+
 #define FRAME_SIZE_X 13
 #define FRAME_SIZE_Y 13
 
+/* Size of the screen buffer, anything outside is not drawn */
+#define TUI_SCREEN_X 80
+#define TUI_SCREEN_Y 24
+
 typedef enum _color
 {
 	BLACK, RED, GREEN, YELLOW, BLUE, MAGENTA, CYAN, WHITE, SYS_DEFAULT
@@ -53,13 +59,36 @@ void clear_screen_from_cursor_down(void);
  */
 void tui_init(void);
 void tui_deinit(void);
+/* Also invalidates the screen buffer */
 void tui_clear_screen(void);
 void tui_print(const char *txt, Color fg, Color bg, Style sty);
 void tui_text_cell_init(Text_Cell *tc);
 void tui_frame_init(size_t x, size_t y, size_t size_x, size_t size_y);
 void tui_frame_clear(void);
+/* Copies the frame into the screen buffer */
 void tui_frame_draw(void);
 int tui_frame_set(size_t x, size_t y, const Text_Cell *tc);
 void tui_frame_fill(Color fg, Color bg, Style sty, const char *txt);
 
+
+/*
+ * Screen buffer
+ * Drawing goes into a back buffer. tui_flush() compares it with what is
+ * on screen and sends only the cells that changed, in a single write().
+ */
+/* Blanks the back buffer, call before drawing a new frame */
+void tui_begin(void);
+int tui_set(size_t x, size_t y, const Text_Cell *tc);
+/* A newline continues in the next row at column x.
+ * Returns the column after the text.
+ */
+size_t tui_text(size_t x, size_t y, const char *txt,
+		Color fg, Color bg, Style sty);
+/* Leaves the cursor at (cursor_x, cursor_y). Starts counting at 0. */
+void tui_flush(size_t cursor_x, size_t cursor_y);
+/* The screen was changed without the buffer, e.g. by printf(). The next
+ * tui_flush() redraws everything.
+ */
+void tui_invalidate(void);
+
 #endif
@@ -0,0 +1,124 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright (c) 2023 Rainer Holzner <rholzner@web.de> */
+
+#include <stddef.h>
+#include <string.h>
+#include "grid.h"
+#include "undo.h"
+
+/* Bytes of an entry with n changes */
+#define ENTRY_SIZE(n) (2 + 3*(size_t)(n))
+
+static unsigned char get(const Undo *u, size_t offset)
+{
+	return u->log[offset % UNDO_SIZE];
+}
+
+static void put(Undo *u, size_t offset, unsigned char c)
+{
+	u->log[offset % UNDO_SIZE] = c;
+}
+
+void undo_reset(Undo *u)
+{
+	u->start = u->cur = u->end = 0;
+	u->num_pending = 0;
+}
+
+void undo_add(Undo *u, unsigned cell_no, unsigned char old, unsigned char new)
+{
+	unsigned i;
+
+	/* A cell that changes twice in one command keeps its first old
+	 * value
+	 */
+	for (i = 0; i < u->num_pending; i++)
+	{
+		if (u->pending[i].cell_no == cell_no)
+		{
+			u->pending[i].new = new;
+			return;
+		}
+	}
+	if (u->num_pending < GRID_CELLS)
+	{
+		u->pending[u->num_pending].cell_no = (unsigned char)cell_no;
+		u->pending[u->num_pending].old = old;
+		u->pending[u->num_pending].new = new;
+		u->num_pending++;
+	}
+}
+
+void undo_commit(Undo *u)
+{
+	size_t size, pos;
+	unsigned i, n = 0;
+
+	/* Drop changes that were undone within the command */
+	for (i = 0; i < u->num_pending; i++)
+	{
+		if (u->pending[i].old != u->pending[i].new)
+		{
+			u->pending[n++] = u->pending[i];
+		}
+	}
+	u->num_pending = 0;
+	if (n == 0)
+	{
+		return;
+	}
+
+	size = ENTRY_SIZE(n);
+	u->end = u->cur;
+	while (u->end + size - u->start > UNDO_SIZE)
+	{
+		u->start += ENTRY_SIZE(get(u, u->start));
+	}
+	pos = u->end;
+	put(u, pos++, (unsigned char)n);
+	for (i = 0; i < n; i++)
+	{
+		put(u, pos++, u->pending[i].cell_no);
+		put(u, pos++, u->pending[i].old);
+		put(u, pos++, u->pending[i].new);
+	}
+	put(u, pos++, (unsigned char)n);
+	u->cur = u->end = pos;
+}
+
+int undo_undo(Undo *u, Undo_Apply apply, void *arg)
+{
+	size_t pos;
+	unsigned n;
+
+	if (u->cur == u->start)
+	{
+		return -1;
+	}
+	n = get(u, u->cur - 1);
+	u->cur -= ENTRY_SIZE(n);
+	/* Last change first */
+	for (pos = u->cur + 1 + 3*(size_t)n; pos > u->cur + 1; pos -= 3)
+	{
+		apply(get(u, pos - 3), get(u, pos - 2), arg);
+	}
+	return 0;
+}
+
+int undo_redo(Undo *u, Undo_Apply apply, void *arg)
+{
+	size_t pos;
+	unsigned n;
+
+	if (u->cur == u->end)
+	{
+		return -1;
+	}
+	n = get(u, u->cur);
+	for (pos = u->cur + 1; pos < u->cur + 1 + 3*(size_t)n; pos += 3)
+	{
+		apply(get(u, pos), get(u, pos + 2), arg);
+	}
+	u->cur += ENTRY_SIZE(n);
+	return 0;
+}
@@ -0,0 +1,55 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright (c) 2023 Rainer Holzner <rholzner@web.de> */
+
+#ifndef _UNDO_H_
+#define _UNDO_H_
+
+#include <stddef.h>
+#include "grid.h"
+
+/* Size of the log in bytes. An edit of one cell takes 5 bytes, clearing
+ * or solving a whole puzzle at most 245.
+ */
+#define UNDO_SIZE 8192
+
+/* A cell as stored in the log: value in bits 0-3, fixed in bit 4 */
+#define UNDO_CELL(val, fix) ((unsigned char)((val) | ((fix) ? 0x10 : 0)))
+#define UNDO_VALUE(c) ((c) & 0x0f)
+#define UNDO_FIXED(c) (((c) & 0x10) != 0)
+
+typedef struct _undo_change
+{
+	unsigned char cell_no, old, new;
+} Undo_Change;
+
+/* Undo and redo log.
+ * Each entry holds the cells changed by one command: the count, the
+ * changes (cell, old, new) and the count again, so that the log can be
+ * walked both ways. Entries are kept in a ring buffer; when it is full,
+ * the oldest ones are dropped.
+ */
+typedef struct _undo
+{
+	unsigned char log[UNDO_SIZE];
+	/* Byte offsets, they only grow: oldest entry, next undo, end */
+	size_t start, cur, end;
+	/* The entry being recorded */
+	Undo_Change pending[GRID_CELLS];
+	unsigned num_pending;
+} Undo;
+
+/* Called for each cell to restore, with the value to set */
+typedef void (*Undo_Apply)(unsigned cell_no, unsigned char cell, void *arg);
+
+void undo_reset(Undo *u);
+/* Records a change of a cell for the entry being recorded */
+void undo_add(Undo *u, unsigned cell_no, unsigned char old, unsigned char new);
+/* Ends the entry being recorded, and drops everything that could be
+ * redone. Does nothing if no cell changed.
+ */
+void undo_commit(Undo *u);
+/* Return 0 on success, -1 if there is nothing to undo or redo */
+int undo_undo(Undo *u, Undo_Apply apply, void *arg);
+int undo_redo(Undo *u, Undo_Apply apply, void *arg);
+
+#endif
@@ -4,6 +4,9 @@
 #ifndef _UTIL_H_
 #define _UTIL_H_
 
+/* Returns buf, or NULL if the text is cut to fit into buf. The text is
+ * terminated either way.
+ */
 char *make_string(char *buf, size_t buf_size, const char *fmt, ...);
 char *make_filepath(const char *dir, const char *filename,
 		char *filepath, size_t size);
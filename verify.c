@@ -0,0 +1,318 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/* Copyright (c) 2023 Rainer Holzner <rholzner@web.de> */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <getopt.h>
+#include "grid.h"
+#include "search.h"
+#include "engine.h"
+#include "crosscheck.h"
+
+/* Values of options without a short form */
+enum
+{
+	OPT_VARIANT = 256
+};
+
+typedef struct _counts
+{
+	size_t random, corpus, malformed, skipped;
+} Counts;
+
+static const char *argv0;
+/* Only one instance, it is too large for the stack */
+static Crosscheck check;
+static uint64_t rng_state;
+
+static void usage(void)
+{
+	fprintf(stderr, "usage: %s [-n num] [-s seed] [-b budget] "
+			"[--variant file] [file...]\n", argv0);
+}
+
+static int parse_size(const char *str, size_t *value)
+{
+	char *end;
+	unsigned long long v;
+
+	if (str[0] < '0' || str[0] > '9')
+	{
+		return -1;
+	}
+	v = strtoull(str, &end, 10);
+	if (*end != '\0')
+	{
+		return -1;
+	}
+	*value = (size_t)v;
+	return 0;
+}
+
+/* xorshift64*, the same puzzles for the same seed everywhere */
+static unsigned rnd(unsigned n)
+{
+	rng_state ^= rng_state >> 12;
+	rng_state ^= rng_state << 25;
+	rng_state ^= rng_state >> 27;
+	return (unsigned)((rng_state * 0x2545f4914f6cdd1du) >> 32) % n;
+}
+
+/* A random solved grid: the solution of a few random clues, with the
+ * values swapped at random. Either works for variants too.
+ */
+static void random_solution(Grid solution)
+{
+	unsigned char map[10];
+	Grid g;
+	unsigned i, j, t;
+
+	do
+	{
+		memset(g, 0, sizeof(g));
+		for (i = rnd(12); i > 0; i--)
+		{
+			g[rnd(GRID_CELLS)] = (unsigned char)(1 + rnd(9));
+		}
+	}
+	while (grid_check(g) < 0 || engine_init(&check.engine, g) != 0 ||
+		engine_count(&check.engine, 1) != 1);
+
+	for (i = 0; i < 10; i++)
+	{
+		map[i] = (unsigned char)i;
+	}
+	for (i = 9; i > 1; i--)
+	{
+		j = 1 + rnd(i);
+		t = map[i];
+		map[i] = map[j];
+		map[j] = (unsigned char)t;
+	}
+	for (i = 0; i < GRID_CELLS; i++)
+	{
+		solution[i] = map[check.engine.solution[i]];
+	}
+}
+
+/* Mostly clues of a solution, so that all numbers of solutions occur,
+ * some with wrong values, and some random values
+ */
+static void random_puzzle(Grid g)
+{
+	Grid solution;
+	unsigned i, keep;
+
+	memset(g, 0, GRID_CELLS);
+	if (rnd(8) == 0)
+	{
+		for (i = rnd(30); i > 0; i--)
+		{
+			g[rnd(GRID_CELLS)] = (unsigned char)(1 + rnd(9));
+		}
+		return;
+	}
+	random_solution(solution);
+	keep = 20 + rnd(61);
+	for (i = 0; i < GRID_CELLS; i++)
+	{
+		if (rnd(100) < keep)
+		{
+			g[i] = solution[i];
+		}
+	}
+	if (rnd(3) == 0)
+	{
+		for (i = 1 + rnd(3); i > 0; i--)
+		{
+			g[rnd(GRID_CELLS)] = (unsigned char)rnd(10);
+		}
+	}
+}
+
+/* Removes clues one at a time as long as the engines still disagree */
+static void shrink(Grid g)
+{
+	bool changed = true;
+	unsigned i, v;
+
+	while (changed)
+	{
+		changed = false;
+		for (i = 0; i < GRID_CELLS; i++)
+		{
+			if (g[i] == 0)
+			{
+				continue;
+			}
+			v = g[i];
+			g[i] = 0;
+			if (crosscheck_puzzle(&check, g) == 1)
+			{
+				changed = true;
+			}
+			else
+			{
+				g[i] = (unsigned char)v;
+			}
+		}
+	}
+	crosscheck_puzzle(&check, g);
+}
+
+static void report(const Grid g)
+{
+	char buf[GRID_LINE_LEN + 1];
+	Grid small;
+	int clues = 0, i;
+
+	buf[GRID_LINE_LEN] = '\0';
+	grid_format(g, buf);
+	fprintf(stderr, "%s: %s\n  %s\n", argv0, check.why, buf);
+	memcpy(small, g, sizeof(small));
+	shrink(small);
+	for (i = 0; i < GRID_CELLS; i++)
+	{
+		clues += (small[i] != 0);
+	}
+	grid_format(small, buf);
+	fprintf(stderr, "shrunk to %d clues: %s\n  %s\n", clues, check.why,
+			buf);
+}
+
+/* Returns 0 if all agree, 1 on a disagreement, -1 if the budget ran out */
+static int run(const Grid g, Counts *c)
+{
+	int ret;
+
+	ret = crosscheck_puzzle(&check, g);
+	if (ret < 0)
+	{
+		c->skipped++;
+	}
+	else if (ret > 0)
+	{
+		report(g);
+	}
+	return ret;
+}
+
+/* Returns 0 if all puzzles of the file agree, else 1 */
+static int run_file(const char *path, Counts *c)
+{
+	char *line = NULL;
+	size_t size = 0;
+	ssize_t len;
+	FILE *fp;
+	Grid g;
+	int ret = 0;
+
+	fp = fopen(path, "r");
+	if (fp == NULL)
+	{
+		perror(path);
+		return 1;
+	}
+	while (ret == 0 && (len = getline(&line, &size, fp)) != -1)
+	{
+		if (grid_parse(g, line, (size_t)len) != 0)
+		{
+			c->malformed++;
+			continue;
+		}
+		c->corpus++;
+		ret = (run(g, c) == 1);
+	}
+	if (ferror(fp))
+	{
+		perror(path);
+		ret = 1;
+	}
+	free(line);
+	fclose(fp);
+	return ret;
+}
+
+int main(int argc, char *argv[])
+{
+	static const struct option long_options[] =
+	{
+		{ "variant", required_argument, NULL, OPT_VARIANT },
+		{ NULL, 0, NULL, 0 }
+	};
+	Counts c = { 0 };
+	size_t num = 1000, seed = 1, line_no, i;
+	const char *variant = NULL;
+	Grid g;
+	int opt, ret = 0;
+
+	argv0 = argv[0];
+	check.budget = 1000000;
+	while ((opt = getopt_long(argc, argv, "b:n:s:", long_options,
+			NULL)) != -1)
+	{
+		switch (opt)
+		{
+		case 'b':
+			if (parse_size(optarg, &check.budget) < 0)
+			{
+				usage();
+				return 1;
+			}
+			break;
+		case 'n':
+			if (parse_size(optarg, &num) < 0)
+			{
+				usage();
+				return 1;
+			}
+			break;
+		case 's':
+			if (parse_size(optarg, &seed) < 0)
+			{
+				usage();
+				return 1;
+			}
+			break;
+		case OPT_VARIANT:
+			variant = optarg;
+			break;
+		default:
+			usage();
+			return 1;
+		}
+	}
+	if (variant && grid_load_variant(variant, &line_no) != 0)
+	{
+		if (errno == EINVAL)
+			fprintf(stderr, "%s:%zu: Error: Invalid region "
+					"description!\n", variant, line_no);
+		else
+			perror(variant);
+		return 1;
+	}
+	search_setup();
+	engine_setup();
+	check.engine.cancel = NULL;
+	/* xorshift must not start at 0 */
+	rng_state = (uint64_t)seed * 0x9e3779b97f4a7c15u + 1;
+
+	for (i = optind; ret == 0 && (int)i < argc; i++)
+	{
+		ret = run_file(argv[i], &c);
+	}
+	for (i = 0; ret == 0 && i < num; i++)
+	{
+		random_puzzle(g);
+		c.random++;
+		ret = (run(g, &c) == 1);
+	}
+	printf("random=%zu corpus=%zu malformed=%zu skipped=%zu seed=%zu%s\n",
+			c.random, c.corpus, c.malformed, c.skipped, seed,
+			ret ? " FAILED" : "");
+	return ret;
+}